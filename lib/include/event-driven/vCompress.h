@@ -0,0 +1,73 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VCOMPRESS__
+#define __VCOMPRESS__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace ev {
+
+/// \brief lossless compression of encoded event packets for slow links. A
+/// packet is a sequence of events of row_ints ints each, the first being the
+/// timestamp and the second the address (as encoded by AddressEvent). Stamps
+/// are stored as varint deltas, the x and y of the address as varint deltas
+/// and its remaining bits as a change mask, followed by an order-0 rANS
+/// entropy stage (skipped when it does not pay off, e.g. small packets).
+/// Any other event layout is still compressed losslessly, only less well.
+class vPacketCompressor
+{
+private:
+
+    std::vector<uint8_t> symbols;
+    std::vector<uint8_t> coded;
+    std::vector<uint8_t> packed;
+    struct slot { uint16_t freq; uint16_t offset; uint8_t symbol; };
+    std::vector<slot> decode_table;
+    std::vector<int32_t> prev;
+
+    void transform(const int32_t *data, unsigned int n_ints,
+                   unsigned int row_ints);
+    bool untransform(const uint8_t *in, size_t n_bytes, unsigned int n_ints,
+                     unsigned int row_ints, std::vector<int32_t> &out);
+    bool entropyEncode(std::vector<uint8_t> &out);
+    bool entropyDecode(const uint8_t *&in, const uint8_t *end, size_t n);
+
+public:
+
+    /// \brief the suffix added to the event type of a compressed packet
+    static const std::string tag;
+
+    /// \brief compress n_ints of encoded events into out (resized to the
+    /// compressed size, padded to whole ints). \returns the number of ints
+    unsigned int compress(const int32_t *data, unsigned int n_ints,
+                          unsigned int row_ints, std::vector<int32_t> &out);
+
+    /// \brief restore a packet made by compress(). \returns false if the
+    /// data is not a valid compressed packet, or claims more events than
+    /// n_ints could carry (nothing is allocated for them)
+    bool decompress(const int32_t *data, unsigned int n_ints,
+                    std::vector<int32_t> &out);
+
+};
+
+}
+
+#endif
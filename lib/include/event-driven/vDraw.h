@@ -147,6 +147,18 @@ protected:
     //image with warped square drawn
     cv::Mat baseimage;
 
+    //projection of each sensor pixel (at z = 0) and of each z offset, so
+    //that only the time term is computed per event
+    std::vector<float> proj_x;
+    std::vector<float> proj_y;
+    std::vector<float> z_x;
+    std::vector<float> z_y;
+
+    //per polarity event density in the projected image
+    cv::Mat density_pos;
+    cv::Mat density_neg;
+    cv::Mat isoimage;
+
 public:
 
     void initialise();
@@ -1026,12 +1026,79 @@ public:
 
 
 
+/**
+ * @brief The taxelSprites class holds, for each taxel address, the patch of
+ * the base image with the taxel already drawn in each polarity colour. The
+ * patches are rasterised once, so drawing a taxel is a table lookup and a
+ * masked copy of a small image: only the pixels the circle covers are
+ * written, as cv::circle would, so neighbouring taxels are left untouched.
+ */
+class taxelSprites {
+
+private:
+
+    static const int n_taxels = 1024; //taxel addresses are 10 bits
+
+    std::vector<cv::Rect> roi;
+    std::vector<cv::Mat> sprite[2];
+    std::vector<cv::Mat> mask;
+
+public:
+
+    void initialise(const cv::Mat &baseimage, const loadMap &tmap, int radius,
+                    const cv::Vec3b &c0, const cv::Vec3b &c1)
+    {
+        roi.assign(n_taxels, cv::Rect());
+        sprite[0].assign(n_taxels, cv::Mat());
+        sprite[1].assign(n_taxels, cv::Mat());
+        mask.assign(n_taxels, cv::Mat());
+
+        cv::Rect canvas(0, 0, baseimage.cols, baseimage.rows);
+        for(auto it = tmap.pos.begin(); it != tmap.pos.end(); it++) {
+            if(it->first < 0 || it->first >= n_taxels) continue;
+
+            int x = tmap.xoffset + tmap.scaling* std :: get<0>(it->second);
+            int y = tmap.yoffset + tmap.scaling* std :: get<1>(it->second);
+            cv::Rect r = cv::Rect(x - radius - 1, y - radius - 1,
+                                  2 * radius + 3, 2 * radius + 3) & canvas;
+            if(r.area() <= 0) continue;
+
+            //draw in a copy of the local patch so anti-aliasing matches
+            cv::Point centr(x - r.x, y - r.y);
+            roi[it->first] = r;
+            baseimage(r).copyTo(sprite[0][it->first]);
+            cv::circle(sprite[0][it->first], centr, radius, c0, cv::FILLED, cv::LINE_AA);
+            baseimage(r).copyTo(sprite[1][it->first]);
+            cv::circle(sprite[1][it->first], centr, radius, c1, cv::FILLED, cv::LINE_AA);
+            mask[it->first] = cv::Mat::zeros(r.size(), CV_8U);
+            cv::circle(mask[it->first], centr, radius, 255, cv::FILLED, cv::LINE_AA);
+        }
+    }
+
+    bool mapped(unsigned int taxel) const
+    {
+        return taxel < roi.size() && roi[taxel].area() > 0;
+    }
+
+    void blit(cv::Mat &image, unsigned int taxel, int polarity) const
+    {
+        cv::Mat patch = image(roi[taxel]);
+        sprite[polarity ? 1 : 0][taxel].copyTo(patch, mask[taxel]);
+    }
+
+};
+
 class skinDraw : public vDraw {
 
 private:
 
     loadMap tmap;
     cv::Mat baseimage;
+    taxelSprites sprites;
+
+    //per taxel frame in which it was last drawn
+    std::vector<unsigned int> last_frame;
+    unsigned int frame;
 
     int radius;
 
@@ -1062,6 +1129,10 @@ public:
             cv::circle(baseimage, centr_all, radius, black,1, cv::LINE_AA);
         }
 
+        sprites.initialise(baseimage, tmap, radius, aqua, violet);
+        last_frame.assign(1024, 0);
+        frame = 0;
+
     };
 
 
@@ -0,0 +1,130 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VFANOUT__
+#define __VFANOUT__
+
+#include "event-driven/vCodec.h"
+#include "event-driven/vPort.h"
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace ev {
+
+/// \brief splits a stream of events of type T to several vWritePorts. Each
+/// event is encoded once, into a buffer shared by all outputs, and each
+/// output selects the events it sends by index. An output that selects a
+/// contiguous run of events (e.g. a stereo output taking every event) is
+/// written straight from the shared buffer; other outputs gather the encoded
+/// events, which is a copy of their raw ints and not a second encoding.
+template <typename T> class vFanOut
+{
+private:
+
+    std::vector<vWritePort *> ports;
+    std::vector< std::vector<unsigned int> > selected;
+
+    std::vector<int32_t> encoded;
+    std::vector<int32_t> gathered;
+    unsigned int n_events;
+    unsigned int ints;
+
+public:
+
+    vFanOut() : n_events(0), ints(packetSize(T::tag)) {}
+
+    /// \brief add an (opened) port as an output. \returns the output index
+    /// used by select(), count() and write(). An index of -1 can be used for
+    /// an output that is not in use: nothing is selected or counted for it
+    int addOutput(vWritePort &port)
+    {
+        ports.push_back(&port);
+        selected.emplace_back();
+        return ports.size() - 1;
+    }
+
+    /// \brief start a new packet
+    void clear()
+    {
+        n_events = 0;
+        for(auto &s : selected)
+            s.clear();
+    }
+
+    /// \brief encode an event into the shared buffer. \returns its index
+    unsigned int add(const T &v)
+    {
+        unsigned int pos = n_events * ints;
+        if(encoded.size() < pos + ints)
+            encoded.resize(std::max<size_t>(2 * encoded.size(), pos + ints));
+        v.encode(encoded, pos);
+        return n_events++;
+    }
+
+    /// \brief send the event with the given index on an output
+    void select(int output, unsigned int event)
+    {
+        if(output >= 0)
+            selected[output].push_back(event);
+    }
+
+    /// \brief the number of events selected for an output
+    size_t count(int output) const
+    {
+        return output >= 0 ? selected[output].size() : 0;
+    }
+
+    /// \brief write the events selected for an output, if there are any
+    bool write(int output, yarp::os::Stamp &envelope)
+    {
+        if(output < 0)
+            return true;
+        const std::vector<unsigned int> &s = selected[output];
+        if(s.empty())
+            return true;
+
+        vWritePort &port = *ports[output];
+        port.setWriteType(T::tag);
+
+        if(s.back() - s.front() + 1 == s.size())
+            return port.write(encoded.data() + s.front() * ints,
+                              s.size() * ints, envelope);
+
+        if(gathered.size() < s.size() * ints)
+            gathered.resize(s.size() * ints);
+        int32_t *dst = gathered.data();
+        for(auto i : s) {
+            std::memcpy(dst, encoded.data() + i * ints, ints * sizeof(int32_t));
+            dst += ints;
+        }
+        return port.write(gathered.data(), s.size() * ints, envelope);
+    }
+
+    /// \brief write every output that has events selected
+    void writeAll(yarp::os::Stamp &envelope)
+    {
+        for(size_t i = 0; i < ports.size(); i++)
+            write(i, envelope);
+    }
+
+};
+
+}
+
+#endif
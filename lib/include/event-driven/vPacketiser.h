@@ -0,0 +1,175 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VPACKETISER__
+#define __VPACKETISER__
+
+#include <yarp/os/all.h>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <sstream>
+
+namespace ev {
+
+/// \brief decides when a device-side grabber should close the packet it is
+/// filling: when it reaches a byte budget, or when the oldest data in it is
+/// older than a latency deadline, whichever comes first. A deadline of 0
+/// leaves the decision to the grabber (typically: close when the device has
+/// no more data). Both limits can be changed at runtime (e.g. through RPC)
+/// while the grabber is running, and statistics of the closed packets are
+/// kept.
+class vPacketiser
+{
+public:
+
+    enum reason { BUDGET = 0, DEADLINE = 1, DRAINED = 2 };
+
+private:
+
+    std::atomic<size_t> budget;
+    std::atomic<double> deadline;
+
+    //statistics since the last reset
+    std::mutex m;
+    std::vector<unsigned int> size_hist; //log2 of the packet size in bytes
+    unsigned int closed[3];
+    unsigned int packets;
+    double bytes;
+    double age_total;
+    double age_max;
+
+public:
+
+    vPacketiser(size_t budget = 0, double deadline = 0.0) :
+        budget(budget), deadline(deadline), size_hist(32, 0)
+    {
+        resetStats();
+    }
+
+    void setBudget(size_t bytes) { budget = bytes; }
+    size_t getBudget() const { return budget; }
+
+    /// \brief set the maximum age (in seconds) of a packet
+    void setDeadline(double seconds) { deadline = seconds; }
+    double getDeadline() const { return deadline; }
+
+    /// \brief true if a packet opened (first data arrived) at the given time
+    /// has passed the deadline
+    bool expired(double opened) const
+    {
+        double d = deadline;
+        return d > 0 && yarp::os::Time::now() - opened >= d;
+    }
+
+    /// \brief true if the packet should be closed now
+    bool due(size_t bytes, double opened) const
+    {
+        return bytes >= budget || (bytes && expired(opened));
+    }
+
+    /// \brief record a packet that has been closed
+    void record(size_t bytes, double opened, reason why)
+    {
+        double age = yarp::os::Time::now() - opened;
+        unsigned int bin = 0;
+        while((bytes >> (bin + 1)) && bin < size_hist.size() - 1) bin++;
+
+        std::lock_guard<std::mutex> lock(m);
+        size_hist[bin]++;
+        closed[why]++;
+        packets++;
+        this->bytes += bytes;
+        age_total += age;
+        if(age > age_max) age_max = age;
+    }
+
+    void resetStats()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        std::fill(size_hist.begin(), size_hist.end(), 0);
+        closed[BUDGET] = closed[DEADLINE] = closed[DRAINED] = 0;
+        packets = 0;
+        bytes = age_total = age_max = 0.0;
+    }
+
+    /// \brief the statistics as (budget deadline packets mean_bytes
+    /// mean_age max_age (closed_budget closed_deadline closed_drained)
+    /// (histogram of log2 packet size))
+    yarp::os::Bottle stats()
+    {
+        yarp::os::Bottle b;
+        std::lock_guard<std::mutex> lock(m);
+        b.addInt((int)budget);
+        b.addDouble(deadline);
+        b.addInt(packets);
+        b.addDouble(packets ? bytes / packets : 0.0);
+        b.addDouble(packets ? age_total / packets : 0.0);
+        b.addDouble(age_max);
+        yarp::os::Bottle &c = b.addList();
+        for(auto n : closed) c.addInt(n);
+        yarp::os::Bottle &h = b.addList();
+        for(auto n : size_hist) h.addInt(n);
+        return b;
+    }
+
+    std::string statString()
+    {
+        std::ostringstream oss;
+        std::lock_guard<std::mutex> lock(m);
+        oss << packets << " packets, mean "
+            << (int)(packets ? bytes / packets : 0) << " bytes, age "
+            << (packets ? 1000.0 * age_total / packets : 0.0) << "ms (max "
+            << 1000.0 * age_max << "ms), closed on budget/deadline/drained "
+            << closed[BUDGET] << "/" << closed[DEADLINE] << "/"
+            << closed[DRAINED];
+        return oss.str();
+    }
+
+    /// \brief handle the commands: "budget <bytes>", "deadline <ms>",
+    /// "stats" and "reset"
+    bool respond(const yarp::os::Bottle &command, yarp::os::Bottle &reply)
+    {
+        std::string cmd = command.get(0).asString();
+        if(cmd == "budget") {
+            if(command.size() > 1) {
+                if(command.get(1).asInt() <= 0) return false;
+                setBudget(command.get(1).asInt());
+            }
+            reply.addInt((int)getBudget());
+        } else if(cmd == "deadline") {
+            if(command.size() > 1)
+                setDeadline(command.get(1).asDouble() * 0.001);
+            reply.addDouble(getDeadline() * 1000.0);
+        } else if(cmd == "stats") {
+            reply.append(stats());
+        } else if(cmd == "reset") {
+            resetStats();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+};
+
+}
+
+#endif
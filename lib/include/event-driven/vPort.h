@@ -24,6 +24,9 @@
 #include <mutex>
 #include "event-driven/vCodec.h"
 #include "event-driven/vtsHelper.h"
+#include "event-driven/vShm.h"
+#include "event-driven/vCompress.h"
+#include "event-driven/vTrace.h"
 
 using namespace yarp::os;
 using std::vector;
@@ -47,11 +50,16 @@ protected:
     unsigned int datalength; //<- set the number of bytes here
     string event_type;
     unsigned int ints_to_read; //<- in integers
+    const int32_t *readblock; //<- internaldata, or data held elsewhere
 
     //sizes
     unsigned int elementINTS;
     unsigned int elementBYTES;
 
+    //compressed packets
+    vPacketCompressor compressor;
+    vector<int32_t> unpacked;
+
 public:
 
     vector<int32_t> internaldata;
@@ -67,6 +75,8 @@ public:
         header3.push_back(0); // <- set the number of ints here (e.g. 2 * #v's)
         elementINTS = 0;
         elementBYTES = sizeof(int32_t) * elementINTS;
+        readblock = nullptr;
+        ints_to_read = 0;
     }
 
     /// \brief set the type of event that this vBottleMimic will send
@@ -213,10 +223,81 @@ public:
             yError() << "Could not read datablock";
             return false;
         }
+        readblock = internaldata.data();
+
+        //a compressed packet: restore the events it carries
+        const std::string &ztag = vPacketCompressor::tag;
+        if(event_type.size() > ztag.size() &&
+                !event_type.compare(event_type.size() - ztag.size(),
+                                    ztag.size(), ztag)) {
+            if(!compressor.decompress(readblock, ints_to_read, unpacked)) {
+                yError() << "Could not decompress datablock";
+                return false;
+            }
+            event_type.resize(event_type.size() - ztag.size());
+            readblock = unpacked.data();
+            ints_to_read = unpacked.size();
+        }
 
         return true;
     }
 
+    /// \brief send a compressed copy of the data prepared in another
+    /// vPortableInterface. The event type is sent with the compression tag,
+    /// which a reading vPortableInterface removes when it decompresses.
+    void setCompressedData(const vPortableInterface &raw)
+    {
+        unsigned int n = compressor.compress((const int32_t *)raw.datablock,
+                                             raw.datalength / sizeof(int32_t),
+                                             raw.elementINTS, internaldata);
+        header2 = raw.header2 + vPacketCompressor::tag;
+        header1[3] = header2.size();
+        header3[1] = n;
+        this->datablock = (const char *)internaldata.data();
+        this->datalength = n * sizeof(int32_t);
+    }
+
+    /// \brief decode the next packet from data that is held elsewhere (e.g.
+    /// in shared memory) rather than read from a connection.
+    void setReadData(const std::string &type, const int32_t *data,
+                     unsigned int ints)
+    {
+        event_type = type;
+        readblock = data;
+        ints_to_read = ints;
+    }
+
+    /// \brief the encoded data prepared by setExternalData/setInternalData
+    const char * getDataBlock() const
+    {
+        return datablock;
+    }
+
+    /// \brief the number of bytes prepared by setExternalData/setInternalData
+    unsigned int getDataLength() const
+    {
+        return datalength;
+    }
+
+    /// \brief the event type being written
+    const std::string &getWriteType() const
+    {
+        return header2;
+    }
+
+    /// \brief the number of 32 bit ints received by the last read(), after
+    /// decompression. The data is at readData()
+    unsigned int readSize() const
+    {
+        return ints_to_read;
+    }
+
+    /// \brief the ints received by the last read(), after decompression
+    const int32_t *readData() const
+    {
+        return readblock;
+    }
+
     bool decodePacket(vQueue &read_q)
     {
         int event_size = packetSize(event_type);
@@ -239,7 +320,7 @@ public:
             return false;
         }
 
-        const int32_t *data = internaldata.data();
+        const int32_t *data = readblock;
         for(unsigned int i = 0; i < ints_to_read / event_size; i++) {
             v->decode(data);
             read_q.push_back(v->clone());
@@ -264,7 +345,7 @@ public:
             return false;
         }
 
-        const int32_t *data = internaldata.data();
+        const int32_t *data = readblock;
         read_q.resize(ints_to_read / event_size);
         for(unsigned int i = 0; i < read_q.size(); i++) {
             read_q[i].decode(data);
@@ -274,9 +355,7 @@ public:
 
     bool decodePacket(vector<int32_t> &read_q)
     {
-        read_q.resize(ints_to_read);
-        for(size_t i = 0; i < ints_to_read; i++)
-            read_q[i] = internaldata.at(i);
+        read_q.assign(readblock, readblock + ints_to_read);
 
         return true;
     }
@@ -291,12 +370,30 @@ class vWritePort
 protected:
 
     vPortableInterface internal_storage;
+    vPortableInterface compressed_storage;
     Port port;
+    vShmRing shm;
+    bool compress{false};
 
     bool _internal_write(Stamp &envelope)
     {
+        //readers on this host map the packet from the shared ring. readers
+        //on other hosts connect to the port as normal
+        if(shm.isOpen()) {
+            shm.publish(internal_storage.getWriteType(),
+                        internal_storage.getDataBlock(),
+                        internal_storage.getDataLength(),
+                        envelope.getTime(), envelope.getCount());
+            if(!port.getOutputCount())
+                return true;
+        }
+
         if(!port.setEnvelope(envelope))
             return false;
+        if(compress) {
+            compressed_storage.setCompressedData(internal_storage);
+            return port.write(compressed_storage);
+        }
         if(!port.write(internal_storage))
             return false;
         return true;
@@ -304,14 +401,23 @@ protected:
 
 public:
 
-    bool open(std::string name)
+    /// \brief open the port. With shared_memory each packet is also published
+    /// once to a shared ring that readers on the same host can map (see
+    /// vReadPort::open).
+    bool open(std::string name, bool shared_memory = false)
     {
-        return port.open(name);
+        if(!port.open(name))
+            return false;
+        if(shared_memory && !shm.create(name))
+            yWarning() << "Could not create shared memory for" << name
+                       << "- using the port only";
+        return true;
     }
 
     void close()
     {
         port.close();
+        shm.close();
     }
 
     void setWriteType(std::string tag)
@@ -319,6 +425,13 @@ public:
         internal_storage.setHeader(tag);
     }
 
+    /// \brief compress packets sent on the port (for slow links). Any
+    /// vReadPort decompresses them; the shared memory ring is not compressed
+    void setCompression(bool compress)
+    {
+        this->compress = compress;
+    }
+
     int getOutputCount() {
         return port.getOutputCount();
     }
@@ -338,6 +451,13 @@ public:
         return _internal_write(envelope);
     }
 
+    /// \brief write already encoded events of the type set by setWriteType
+    bool write(const int32_t *data, size_t n_ints, Stamp &envelope)
+    {
+        internal_storage.setExternalData((const char *)data,
+                                         n_ints * sizeof(int32_t));
+        return _internal_write(envelope);
+    }
 
     bool write(const deque<int32_t> &q, Stamp &envelope)
     {
@@ -372,12 +492,19 @@ protected:
 
     vPortableInterface internal_storage;
     Port port;
+    vShmRing shm;
+    std::string shm_source;
+    unsigned int shm_lost;
 
     T *working_queue;
     deque< T* > qq;
     deque<Stamp> sq;
     deque<int> t_q;
     deque<int> n_q;
+    deque<double> arrival_q;
+
+    vPortTrace trace;
+    double handed_out;
 
 
     std::mutex m;
@@ -404,6 +531,8 @@ public:
         unprocdqs = 0;
         working_queue = nullptr;
         p_time = 0;
+        shm_lost = 0;
+        handed_out = 0;
 
         //setPriority(0, SCHED_FIFO);
 
@@ -413,6 +542,7 @@ public:
     /// \brief desctructor
     ~vReadPort()
     {
+        vTrace::remove(&trace);
         m.lock();
         typename deque< T* >::iterator i;
         for(i = qq.begin(); i != qq.end(); i++)
@@ -422,12 +552,25 @@ public:
     }
 
 
-    bool open(std::string name)
+    /// \brief open the port. If shm_source names a vWritePort on this host
+    /// that was opened with shared memory, packets are decoded straight from
+    /// its shared ring. Otherwise the port must be connected as usual.
+    bool open(std::string name, std::string shm_source = "")
     {
         if(!port.open(name)) {
             yError() << "Could not open vGenReadPort input port: " << name;
             return false;
         }
+        trace.name = name;
+        vTrace::add(&trace);
+        this->shm_source = shm_source;
+        if(shm_source.size()) {
+            if(shm.attach(shm_source))
+                yInfo() << "Reading" << shm_source << "through shared memory";
+            else
+                yWarning() << "No shared memory for" << shm_source
+                           << "on this host: connect it to" << name;
+        }
         start();
         return true;
     }
@@ -448,6 +591,8 @@ public:
     {
         this->stop(); //make sure the isStopping() is true
         port.close(); //close the port connections
+        shm.close();
+        vTrace::remove(&trace);
     }
 
     void onStop()
@@ -455,10 +600,83 @@ public:
         port.interrupt(); //port.read() will return false
         read_mutex.unlock(); //allow port.read() to be called
         dataavailable.post(); //all a this->read() to return
+        shm.wake(); //a shared memory read will return
+    }
+
+    void enqueue(T *next_queue, const yarp::os::Stamp &yarp_stamp)
+    {
+        double arrival = yarp::os::Time::now();
+        if(yarp_stamp.isValid())
+            trace.latency.record(arrival - yarp_stamp.getTime());
+
+        m.lock();
+
+        qq.push_back(next_queue);
+        sq.push_back(yarp_stamp);
+        arrival_q.push_back(arrival);
+
+        unprocdqs++;
+
+        n_q.push_back(countEvents<T>(*next_queue));
+        t_q.push_back(countTime<T>(*next_queue, p_time));
+
+        delay_nv += n_q.back();
+        delay_t += t_q.back();
+        if(t_q.back())
+            event_rate = n_q.back() / (double)(t_q.back());
+
+        m.unlock();
+
+        dataavailable.post();
+    }
+
+    void runShared()
+    {
+        //start from the newest packet
+        std::uint64_t seq = shm.wait(0, 0.0) + 1;
+        vShmRing::packet p;
+
+        while(!isStopping()) {
+
+            bool idle = shm.wait(seq - 1, 0.1) < seq;
+            while(shm.peek(seq, p, shm_lost)) {
+                seq++;
+                if(qlimit && qq.size() >= qlimit)
+                    continue;
+
+                internal_storage.setReadData(p.type, p.data, p.ints);
+                T *next_queue = new T;
+                internal_storage.decodePacket(*next_queue);
+                if(!shm.stillValid(p)) {
+                    shm_lost++;
+                    delete next_queue;
+                    continue;
+                }
+                if(countEvents<T>(*next_queue) <= 0) {
+                    delete next_queue;
+                    continue;
+                }
+                enqueue(next_queue, yarp::os::Stamp(p.stamp_count, p.stamp_time));
+            }
+
+            //no packets before the timeout: the writer may have closed, died
+            //or restarted on a new ring. Map the new ring when it is back
+            if(idle && !shm.writerAlive() && !isStopping()) {
+                if(shm.attach(shm_source))
+                    seq = shm.wait(0, 0.0) + 1;
+                else
+                    yarp::os::Time::delay(0.1);
+            }
+        }
     }
 
     void run()
     {
+        if(shm.isOpen()) {
+            runShared();
+            return;
+        }
+
         while(true) {
 
             //blocking read of data from the port
@@ -479,27 +697,12 @@ public:
             port.getEnvelope(yarp_stamp);
             T *next_queue = new T;
             internal_storage.decodePacket(*next_queue);
-            if(countEvents<T>(*next_queue) <= 0)
+            if(countEvents<T>(*next_queue) <= 0) {
+                delete next_queue;
                 continue;
+            }
 
-            m.lock();
-
-            qq.push_back(next_queue);
-            sq.push_back(yarp_stamp);
-
-            unprocdqs++;
-
-            n_q.push_back(countEvents<T>(*next_queue));
-            t_q.push_back(countTime<T>(*next_queue, p_time));
-
-            delay_nv += n_q.back();
-            delay_t += t_q.back();
-            if(t_q.back())
-                event_rate = n_q.back() / (double)(t_q.back());
-
-            m.unlock();
-
-            dataavailable.post();
+            enqueue(next_queue, yarp_stamp);
 
         }
 
@@ -510,6 +713,7 @@ public:
     const T* read(yarp::os::Stamp &yarpstamp, bool wait = true)
     {
         if(working_queue) {
+            trace.process.record(yarp::os::Time::now() - handed_out);
             m.lock();
 
             delay_nv -= n_q.front();
@@ -520,6 +724,7 @@ public:
             delete qq.front();
             qq.pop_front();
             sq.pop_front();
+            arrival_q.pop_front();
             m.unlock();
         }
 
@@ -531,6 +736,8 @@ public:
                 working_queue = qq.front();
                 m.lock();
                 unprocdqs--;
+                handed_out = yarp::os::Time::now();
+                trace.queue.record(handed_out - arrival_q.front());
                 m.unlock();
             }  else {
                 working_queue =  0;
@@ -542,6 +749,8 @@ public:
                 working_queue = qq.front();
                 m.lock();
                 unprocdqs--;
+                handed_out = yarp::os::Time::now();
+                trace.queue.record(handed_out - arrival_q.front());
                 m.unlock();
             } else {
                 working_queue = 0;
@@ -599,6 +808,8 @@ public:
         std::ostringstream oss;
         oss << "qs: " << queryunprocessed() << " events: " << queryDelayN() <<
                " time(s): " << queryDelayT() << " rate: " << queryRate();
+        if(shm.isOpen())
+            oss << " shm lost: " << shm_lost;
         return oss.str();
     }
 
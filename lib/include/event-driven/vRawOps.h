@@ -0,0 +1,104 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VRAWOPS__
+#define __VRAWOPS__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// operations on raw packets of [stamp, address] uint32 pairs as read from the
+// grabber devices, applied before the data is handed to a port.
+
+namespace ev {
+
+/// \brief find the first event whose masked stamp is lower than that of the
+/// event before it. prev is the stamp of the event preceding the packet.
+/// \returns the index of the event, or n if the stamps are monotonic
+inline size_t findStampJump(const uint32_t *data, size_t n, uint32_t mask,
+                            uint32_t prev)
+{
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    //four stamps are compared to their predecessors at once. stops at the
+    //first block containing a jump and lets the scalar loop find it
+    if(mask <= 0x7FFFFFFF) {
+        const __m128i m = _mm_set1_epi32(mask);
+        __m128i before = _mm_set1_epi32(prev & mask);
+        for(; i + 4 <= n; i += 4) {
+            __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(data + 2*i)));
+            __m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(data + 2*i + 4)));
+            __m128i ts = _mm_and_si128(_mm_castps_si128(
+                             _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), m);
+            __m128i pr = _mm_or_si128(_mm_slli_si128(ts, 4),
+                                      _mm_srli_si128(before, 12));
+            if(_mm_movemask_epi8(_mm_cmplt_epi32(ts, pr)))
+                break;
+            before = ts;
+        }
+        if(i) prev = data[2*(i-1)];
+    }
+#endif
+
+    prev &= mask;
+    for(; i < n; i++) {
+        uint32_t ts = data[2*i] & mask;
+        if(ts < prev) return i;
+        prev = ts;
+    }
+    return n;
+}
+
+/// \brief remove the events whose keep flag is zero, in place and preserving
+/// order. \returns the number of events kept
+inline size_t compactEvents(uint32_t *data, const uint8_t *keep, size_t n)
+{
+    size_t k = 0, i = 0;
+
+#if defined(__SSE2__)
+    //two events per register: if only the second is kept it is shuffled into
+    //the first slot. the whole register is always stored at the write
+    //position (never ahead of the read position) and the write position only
+    //advances by the number of events kept
+    for(; i + 2 <= n; i += 2) {
+        int first = keep[i] != 0;
+        int second = keep[i+1] != 0;
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + 2*i));
+        __m128i sel = _mm_set1_epi32(-(!first & second));
+        v = _mm_or_si128(_mm_and_si128(sel, _mm_unpackhi_epi64(v, v)),
+                         _mm_andnot_si128(sel, v));
+        _mm_storeu_si128((__m128i *)(data + 2*k), v);
+        k += first + second;
+    }
+#endif
+
+    for(; i < n; i++) {
+        std::memmove(data + 2*k, data + 2*i, 2 * sizeof(uint32_t));
+        k += keep[i] != 0;
+    }
+    return k;
+}
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VSHM__
+#define __VSHM__
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace ev {
+
+/// \brief a ring of event packets in shared memory, written by a single
+/// vWritePort and read by any number of vReadPorts on the same host. The
+/// writer copies each packet into the ring once, whatever the number of
+/// readers, and readers decode straight from the mapped memory. Readers never
+/// hold back the writer: a reader that falls a full ring behind loses the
+/// oldest packets, and a packet overwritten while it was being decoded is
+/// detected and discarded. The segment is only accessible to the user that
+/// created it. Only available on POSIX systems: elsewhere create() and
+/// attach() fail and ports use YARP alone.
+class vShmRing
+{
+public:
+
+    /// \brief a packet in the ring, valid until the writer overwrites it
+    struct packet {
+        char type[24];
+        std::uint64_t seq;
+        std::uint64_t pos;
+        const std::int32_t *data;
+        unsigned int ints;
+        double stamp_time;
+        int stamp_count;
+    };
+
+private:
+
+    struct header;
+    struct slot;
+
+    header *hdr;
+    slot *slots;
+    char *ring;
+    size_t mapped_bytes;
+    std::uint64_t capacity; //<- as mapped: the shared header is not trusted
+    unsigned int n_slots;
+    std::uint64_t generation;
+    unsigned long device, inode;
+    std::string name;
+    bool owner;
+
+    bool map(int fd, size_t bytes);
+    /// \brief true if the name now refers to another ring (or none)
+    bool replaced() const;
+
+public:
+
+    vShmRing();
+    ~vShmRing();
+
+    /// \brief the shared memory segment name used for a port name
+    static std::string segmentName(const std::string &port_name);
+
+    /// \brief create the ring for a writer. Replaces a stale ring of the
+    /// same name.
+    bool create(const std::string &port_name, size_t bytes = 16 << 20,
+                unsigned int n_slots = 256);
+    /// \brief map the ring of a writer on this host. Fails if there is no
+    /// writer of that name on this host.
+    bool attach(const std::string &port_name);
+    void close();
+
+    bool isOpen() const { return hdr != nullptr; }
+    /// \brief false once the writer has closed the ring, has died, or has been
+    /// replaced by a new writer of the same name (a reader should then
+    /// attach again). Checks the filesystem: call it when packets stop
+    bool writerAlive() const;
+
+    /// \brief copy a packet into the ring and wake the readers
+    bool publish(const std::string &type, const char *block, size_t bytes,
+                 double stamp_time, int stamp_count);
+
+    /// \brief wait until packets after seq are available (or timeout in
+    /// seconds). \returns the number of the latest packet
+    std::uint64_t wait(std::uint64_t seq, double timeout);
+    /// \brief wake any reader waiting on the ring
+    void wake();
+    /// \brief get packet number seq (counting from 1). Advances seq, and
+    /// counts lost packets, if it has already been overwritten
+    bool peek(std::uint64_t &seq, packet &p, unsigned int &lost) const;
+    /// \brief true if the packet was not overwritten while it was used
+    bool stillValid(const packet &p) const;
+
+};
+
+}
+
+#endif
@@ -29,6 +29,8 @@
 #include <deque>
 #include <string>
 #include <map>
+#include <queue>
+#include <limits>
 
 namespace ev {
 
@@ -581,15 +583,16 @@ public:
 };
 
 /// \brief automatically accept events from a port and push them into a
-/// vTempWindow
+/// vPacketWindow per channel
 class tWinThread : public yarp::os::Thread
 {
 private:
 
     ev::vReadPort<vQueue> allocatorCallback;
     //ev::queueAllocator allocatorCallback;
-    vTempWindow windowleft;
-    vTempWindow windowright;
+    vPacketWindow windowleft;
+    vPacketWindow windowright;
+    vQueue split[2];
 
     std::mutex safety;
 
@@ -608,6 +611,12 @@ public:
         strictUpdatePeriod = 0;
         currentPeriod = 0;
         updated = false;
+
+        //whichever is smaller: 2 seconds or 1/2 of the max stamp
+        unsigned int window = std::min(vtsHelper::max_stamp * 0.45,
+                                       vtsHelper::vtsscaler * 2.0);
+        windowleft.setWindow(window);
+        windowright.setWindow(window);
     }
 
     bool open(std::string portname, int period = 0)
@@ -640,16 +649,19 @@ public:
             const ev::vQueue *q = allocatorCallback.read(yarpstamp);
             if(!q) break;
 
+            //split the packet by channel outside of the lock
+            for(ev::vQueue::const_iterator qi = q->begin(); qi != q->end(); qi++) {
+                int channel = (*qi)->getChannel();
+                if(channel == 0 || channel == 1)
+                    split[channel].push_back(*qi);
+            }
+
             if(!strictUpdatePeriod) safety.lock();
 
             if(!ctime) ctime = q->front()->stamp;
 
-            for(ev::vQueue::const_iterator qi = q->begin(); qi != q->end(); qi++) {
-                if((*qi)->getChannel() == 0)
-                    windowleft.addEvent(*qi);
-                else if((*qi)->getChannel() == 1)
-                    windowright.addEvent(*qi);
-            }
+            windowleft.addPacket(std::move(split[0]));
+            windowright.addPacket(std::move(split[1]));
 
             if(strictUpdatePeriod) {
                 int dt = q->back()->stamp - ctime;
@@ -833,6 +845,201 @@ public:
 
 };
 
+/// \brief merge event streams of different types (e.g. AE, FLOW, GAE, IMU)
+/// from multiple ports into a single globally time-ordered vQueue. Each input
+/// keeps its events sorted by stamp (events that arrive out of order on the
+/// same port are inserted in place) and a low-watermark (the stamp of the
+/// newest event it delivered). Only events older than the minimum watermark
+/// of all inputs are released, so the output is ordered regardless of packet
+/// arrival order. An input that falls more than the lateness bound behind the
+/// others (or has not delivered anything by then) no longer holds the output
+/// back; events any input later delivers that are older than what has
+/// already been released are dropped and counted.
+class mergevstreams
+{
+private:
+
+    typedef std::pair<long long, ev::event<> > stampedEvent;
+
+    struct mergeInput {
+        ev::vReadPort<vQueue> port;
+        std::deque<stampedEvent> pending;
+        bool delivered{false};
+        long long watermark{0};
+        unsigned int late{0};
+    };
+
+    //ordered by name for a deterministic tie-break between equal stamps
+    std::map<std::string, mergeInput> inputs;
+    yarp::os::Stamp yStamp;
+    bool started;
+    long long first;
+    long long newest;
+    long long released;
+    long long max_lateness;
+    unsigned int late_total;
+
+    //unwrap a stamp to the period nearest to the reference time
+    static long long unwrap(int stamp, long long reference)
+    {
+        const long long period = vtsHelper::max_stamp;
+        long long t = reference - reference % period + stamp;
+        if(t - reference > period / 2) t -= period;
+        else if(reference - t > period / 2) t += period;
+        return t;
+    }
+
+    //pull all packets that have arrived on an input without blocking
+    void drain(mergeInput &in)
+    {
+        yarp::os::Stamp ys;
+        const vQueue *q;
+        while((q = in.port.read(ys, false))) {
+            if(ys.isValid() && ys.getTime() > yStamp.getTime())
+                yStamp = ys;
+            for(auto &v : *q) {
+                long long t = v->stamp;
+                if(in.delivered)
+                    t = unwrap(v->stamp, in.watermark);
+                else if(started)
+                    t = unwrap(v->stamp, newest);
+
+                if(started && t < released) {
+                    in.late++; late_total++;
+                    continue;
+                }
+
+                //usually at the back: only out of order events are moved
+                auto pos = in.pending.end();
+                while(pos != in.pending.begin() && (pos - 1)->first > t)
+                    pos--;
+                in.pending.insert(pos, stampedEvent(t, v));
+
+                if(!in.delivered || t > in.watermark) in.watermark = t;
+                in.delivered = true;
+                if(!started) {
+                    started = true;
+                    first = newest = released = t - 1;
+                }
+                newest = std::max(newest, t);
+            }
+        }
+    }
+
+public:
+
+    mergevstreams(void)
+    {
+        started = false;
+        first = newest = released = 0;
+        max_lateness = 0.005 * vtsHelper::vtsscaler;
+        late_total = 0;
+    }
+
+    /// \brief open an input port for the given event type
+    bool open(std::string moduleName, std::string eventType)
+    {
+        if(inputs.count(eventType))
+            return true;
+
+        return inputs[eventType].port.open(moduleName + "/" + eventType + ":i");
+    }
+
+    /// \brief set how far (in event timestamps) an input may fall behind the
+    /// most recent input before it no longer holds back the output (default
+    /// 5 ms)
+    void setMaxLateness(int stamps)
+    {
+        max_lateness = stamps;
+    }
+
+    /// \brief collect the newly arrived events of all inputs and return those
+    /// that can be released in global time order
+    vQueue merge()
+    {
+        vQueue out;
+        if(inputs.empty()) return out;
+
+        for(auto &i : inputs)
+            drain(i.second);
+        if(!started) return out;
+
+        //the release point is the slowest input still within the bound. An
+        //input that never delivered holds the output until the bound has
+        //passed the first event
+        long long bound = newest - max_lateness;
+        long long low = newest;
+        for(auto &i : inputs) {
+            if(i.second.delivered) {
+                if(i.second.watermark >= bound)
+                    low = std::min(low, i.second.watermark);
+            } else if(first >= bound) {
+                low = std::min(low, first);
+            }
+        }
+        if(low <= released) return out;
+
+        //k-way merge of the per-input queues
+        typedef std::pair<long long, int> head;
+        std::priority_queue<head, std::vector<head>, std::greater<head> > heap;
+        std::vector<std::deque<stampedEvent> *> sources;
+        for(auto &i : inputs) {
+            if(i.second.pending.size())
+                heap.push(head(i.second.pending.front().first, (int)sources.size()));
+            sources.push_back(&i.second.pending);
+        }
+
+        while(heap.size() && heap.top().first <= low) {
+            int k = heap.top().second;
+            heap.pop();
+            out.push_back(sources[k]->front().second);
+            sources[k]->pop_front();
+            if(sources[k]->size())
+                heap.push(head(sources[k]->front().first, k));
+        }
+
+        released = low;
+        return out;
+    }
+
+    /// \brief the timestamp up to which events have been released
+    int getvstamp()
+    {
+        if(!started) return 0;
+        long long r = released % vtsHelper::max_stamp;
+        return r < 0 ? r + vtsHelper::max_stamp : r;
+    }
+
+    yarp::os::Stamp getystamp()
+    {
+        return yStamp;
+    }
+
+    /// \brief number of events dropped for arriving after their time had
+    /// already been released
+    unsigned int queryLateDrops()
+    {
+        return late_total;
+    }
+
+    void close()
+    {
+        for(auto &i : inputs)
+            i.second.port.close();
+    }
+
+    std::string delayStats()
+    {
+        std::ostringstream oss;
+        for(auto &i : inputs)
+            oss << i.first << ": " << i.second.port.delayStatString()
+                << " pending: " << i.second.pending.size()
+                << " late: " << i.second.late << " ";
+        return oss.str();
+    }
+
+};
+
 }
 
 #endif
@@ -0,0 +1,116 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VTRACE__
+#define __VTRACE__
+
+#include <yarp/os/all.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace ev {
+
+/// \brief a histogram of latencies that can be recorded from any thread
+/// without locking. Buckets are log-linear (HDR style): exact below 16us,
+/// then 16 buckets per power of two (~6% resolution) up to ~70 minutes.
+class vLatencyHistogram
+{
+public:
+
+    static const int SUB_BITS = 4;
+    static const int N_BUCKETS = 29 << SUB_BITS;
+
+private:
+
+    std::atomic<std::uint32_t> buckets[N_BUCKETS];
+    std::atomic<std::uint64_t> n;
+    std::atomic<std::uint64_t> total_us;
+    std::atomic<std::uint64_t> max_us;
+
+    static int bucketOf(std::uint64_t us);
+    static double bucketMiddle(int bucket);
+
+public:
+
+    vLatencyHistogram() { reset(); }
+
+    /// \brief add a latency (in seconds). Negative latencies (e.g. clocks of
+    /// different machines out of sync) are counted as 0
+    void record(double seconds);
+    void reset();
+
+    std::uint64_t count() const { return n; }
+    /// \brief in seconds
+    double mean() const;
+    double max() const;
+    double percentile(double p) const;
+
+    /// \brief append (count mean p50 p90 p99 max), latencies in ms
+    void addTo(yarp::os::Bottle &b) const;
+};
+
+/// \brief the latencies seen at one reading port: from the origin stamp of
+/// a packet (the envelope time set at the sensor) to its arrival, from its
+/// arrival to the module reading it, and the time the module processed it
+/// (until it asked for the next packet)
+struct vPortTrace {
+    std::string name;
+    vLatencyHistogram latency;
+    vLatencyHistogram queue;
+    vLatencyHistogram process;
+};
+
+/// \brief process-wide latency tracing. Every vReadPort adds its vPortTrace
+/// when opened. If a module asks for it with setStatsPort() (the modules
+/// reading with vReadPort do so with --stats), the histograms
+/// of all of them are published periodically on that port (while any
+/// vReadPort is open). Each entry of the published Bottle is
+/// (port (latency ...) (queue ...) (process ...)), see vLatencyHistogram.
+///
+/// The origin stamp travels in the envelope of each packet: modules forward
+/// the stamp they read with what they write (a packet written without a
+/// valid stamp carries no origin). vPreProcess, vCluster (binary) and
+/// binaryDumper forward the stamp of the input packet. atis3-bridge,
+/// vGenerator and esim-yarp stamp packets when they send them, and the
+/// latency downstream is measured from there. Other modules do not write
+/// event packets, so their stats end at their own input ports. Latency
+/// across machines is only meaningful if their clocks are synchronised.
+class vTrace
+{
+public:
+
+    /// \brief publish the stats on a port of this name (e.g.
+    /// <module>/stats:o), or "" to close it. No port is opened unless this
+    /// is called
+    static void setStatsPort(const std::string &name);
+    /// \brief set how often the stats are published (seconds)
+    static void setPeriod(double seconds);
+
+    static void add(vPortTrace *trace);
+    static void remove(vPortTrace *trace);
+
+    /// \brief the stats of all ports, as published
+    static yarp::os::Bottle stats();
+    /// \brief clear the histograms of all ports
+    static void reset();
+};
+
+}
+
+#endif
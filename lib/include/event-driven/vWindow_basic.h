@@ -103,6 +103,58 @@ public:
     vQueue getWindow();
 };
 
+/******************************************************************************/
+/// \brief store whole packets of events for a fixed amount of time. Expiry is
+/// checked once per packet: packets whose newest event is too old are removed
+/// in one step and only the oldest remaining packet is trimmed event by event.
+/// The events are kept contiguous so the window can be read without a copy.
+class vPacketWindow {
+
+protected:
+
+    //! per-packet bookkeeping, held in a circular buffer
+    struct packet {
+        unsigned int n;
+        int last;
+    };
+    std::vector<packet> ring;
+    unsigned int head;
+    unsigned int count;
+
+    //! event storage
+    vQueue q;
+    unsigned int window;
+    int newest;
+
+    unsigned int age(int stamp) const;
+    void pushPacket(unsigned int n, int last);
+    void trim();
+
+public:
+
+    typedef vQueue::const_iterator const_iterator;
+
+    /// \brief create a window of the given duration (in event timestamps).
+    /// A duration of 0 keeps all events.
+    vPacketWindow(unsigned int window = 0);
+
+    void setWindow(unsigned int window);
+    void clear();
+
+    /// \brief add a packet of events, assumed in temporal order
+    void addPacket(const vQueue &packet);
+    /// \brief add a packet of events, moving them into the window
+    void addPacket(vQueue &&packet);
+
+    const_iterator begin() const { return q.begin(); }
+    const_iterator end() const { return q.end(); }
+    size_t size() const { return q.size(); }
+    unsigned int packets() const { return count; }
+
+    /// \brief direct (zero-copy) access to the events in the window
+    const vQueue &getWindow() const { return q; }
+};
+
 }
 
 #endif
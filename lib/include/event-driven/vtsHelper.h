@@ -214,6 +214,57 @@ class cochleaHelper {
         static const int max_num_addresses = nas_addrresses_offset + mso_addresses_offset + lso_addresses_offset;
 
         static int getAddress(const CochleaEvent &ce);
+
+        /// \brief the address only depends on the polarity, freq_chnn,
+        /// xso_type, auditory_model (bits 0-9) and channel (bit 22) fields,
+        /// and linearly on neuron_id (bits 12-18)
+        static constexpr int lutKey(uint32_t word)
+        {
+            return (word & 0x3FF) | ((word >> 12) & 0x400);
+        }
+
+        /// \brief compile-time table of the address of each key: the address
+        /// is base[key] + (neuron_id & neuron_mask[key])
+        struct addressLUT {
+            static const int size = 2048;
+            int base[size];
+            int neuron_mask[size];
+
+            constexpr addressLUT() : base(), neuron_mask()
+            {
+                for(int k = 0; k < size; k++) {
+                    int polarity = k & 0x01;
+                    int freq_chnn = (k >> 1) & 0x7F;
+                    int xso_type = (k >> 8) & 0x01;
+                    int auditory_model = (k >> 9) & 0x01;
+                    int channel = (k >> 10) & 0x01;
+
+                    if(auditory_model == 0) {
+                        //NAS
+                        base[k] = (freq_chnn << 1) + polarity + (channel << 6);
+                        neuron_mask[k] = 0;
+                    } else if(xso_type == 0) {
+                        //MSO
+                        base[k] = nas_addrresses_offset +
+                                (freq_chnn - mso_start_freq_channel) * mso_num_neurons_per_channel;
+                        neuron_mask[k] = 0x7F;
+                    } else {
+                        //LSO
+                        base[k] = nas_addrresses_offset + mso_addresses_offset +
+                                (freq_chnn - lso_start_freq_channel) * lso_num_neurons_per_channel;
+                        neuron_mask[k] = 0x7F;
+                    }
+                }
+            }
+        };
+        static const addressLUT lut;
+
+        /// \brief branch-free address of a raw 32-bit cochlea word
+        static int getAddress(uint32_t word)
+        {
+            int k = lutKey(word);
+            return lut.base[k] + ((word >> 12) & lut.neuron_mask[k]);
+        }
 };
 
 }
@@ -0,0 +1,346 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/vCompress.h"
+#include <cstring>
+
+namespace ev {
+
+const std::string vPacketCompressor::tag = "@z";
+
+// packet layout (bytes, padded with zeros to whole ints):
+//   flags, varint n_ints, varint row_ints,
+//   flags & ENTROPY ? varint n_symbols, frequency table, rANS stream
+//                   : the symbols
+
+static const uint8_t FLAG_VERSION = 0x10;
+static const uint8_t FLAG_ENTROPY = 0x01;
+
+static const uint32_t XY_MASK = (0x3FFu << 1) | (0x1FFu << 12);
+static const unsigned int MAX_INTS = 1u << 26;
+static const unsigned int MAX_ROW_INTS = 64; //ints per event, well above any type
+
+static const unsigned int SCALE_BITS = 12;
+static const uint32_t SCALE = 1u << SCALE_BITS;
+static const uint32_t RANS_L = 1u << 23;
+
+//no symbol is given more than MAX_FREQ of the scale, so each costs at least
+//0.09 bits and a packet of n bytes carries fewer than MAX_EXPANSION * n
+//symbols: a decoder can reject a corrupt size before allocating for it
+static const uint32_t MAX_FREQ = SCALE - SCALE / 16;
+static const size_t MAX_EXPANSION = 128;
+
+static inline uint8_t *putVarint(uint8_t *out, uint32_t v)
+{
+    while(v >= 0x80) {
+        *out++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (uint8_t)v;
+    return out;
+}
+
+static inline void putVarint(std::vector<uint8_t> &out, uint32_t v)
+{
+    while(v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static inline bool getVarint(const uint8_t *&in, const uint8_t *end,
+                             uint32_t &v)
+{
+    v = 0;
+    for(int shift = 0; shift < 35; shift += 7) {
+        if(in >= end) return false;
+        uint8_t b = *in++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+void vPacketCompressor::transform(const int32_t *data, unsigned int n_ints,
+                                  unsigned int row_ints)
+{
+    //at most 5 bytes per int, plus 4 for the 2 extra address varints
+    symbols.resize(5 * n_ints + 4 * (n_ints / row_ints));
+    uint8_t *out = symbols.data();
+
+    prev.assign(row_ints, 0);
+    int32_t px = 0, py = 0;
+
+    for(unsigned int i = 0; i + row_ints <= n_ints; i += row_ints) {
+        const int32_t *row = data + i;
+
+        //the timestamp: wraps are a (rare) large delta
+        out = putVarint(out, zigzag((int32_t)((uint32_t)row[0] - (uint32_t)prev[0])));
+
+        //the address: x and y change by small amounts, the other bits
+        //(polarity, channel, type...) rarely change
+        if(row_ints > 1) {
+            uint32_t a = row[1];
+            int32_t x = (a >> 1) & 0x3FF;
+            int32_t y = (a >> 12) & 0x1FF;
+            out = putVarint(out, zigzag(x - px));
+            out = putVarint(out, zigzag(y - py));
+            out = putVarint(out, (a ^ (uint32_t)prev[1]) & ~XY_MASK);
+            px = x; py = y;
+        }
+
+        for(unsigned int j = 2; j < row_ints; j++)
+            out = putVarint(out, zigzag((int32_t)((uint32_t)row[j] - (uint32_t)prev[j])));
+
+        std::memcpy(prev.data(), row, row_ints * sizeof(int32_t));
+    }
+    symbols.resize(out - symbols.data());
+}
+
+bool vPacketCompressor::untransform(const uint8_t *in, size_t n_bytes,
+                                    unsigned int n_ints, unsigned int row_ints,
+                                    std::vector<int32_t> &out)
+{
+    const uint8_t *end = in + n_bytes;
+    out.resize(n_ints);
+    prev.assign(row_ints, 0);
+    int32_t px = 0, py = 0;
+    uint32_t v;
+
+    for(unsigned int i = 0; i + row_ints <= n_ints; i += row_ints) {
+        int32_t *row = out.data() + i;
+
+        if(!getVarint(in, end, v)) return false;
+        row[0] = (int32_t)((uint32_t)prev[0] + (uint32_t)unzigzag(v));
+
+        if(row_ints > 1) {
+            uint32_t dx, dy, bits;
+            if(!getVarint(in, end, dx) || !getVarint(in, end, dy) ||
+                    !getVarint(in, end, bits))
+                return false;
+            px += unzigzag(dx);
+            py += unzigzag(dy);
+            uint32_t a = (((uint32_t)prev[1] ^ bits) & ~XY_MASK) |
+                    (((uint32_t)px & 0x3FF) << 1) | (((uint32_t)py & 0x1FF) << 12);
+            row[1] = (int32_t)a;
+        }
+
+        for(unsigned int j = 2; j < row_ints; j++) {
+            if(!getVarint(in, end, v)) return false;
+            row[j] = (int32_t)((uint32_t)prev[j] + (uint32_t)unzigzag(v));
+        }
+
+        std::memcpy(prev.data(), row, row_ints * sizeof(int32_t));
+    }
+    return true;
+}
+
+bool vPacketCompressor::entropyEncode(std::vector<uint8_t> &out)
+{
+    //normalise the symbol frequencies to SCALE, every used symbol >= 1
+    uint32_t count[256] = {0};
+    for(auto s : symbols) count[s]++;
+
+    uint32_t freq[256], cum[257];
+    uint32_t total = 0;
+    int largest = 0, n_used = 0;
+    for(int s = 0; s < 256; s++) {
+        freq[s] = 0;
+        if(!count[s]) continue;
+        freq[s] = (uint32_t)(((uint64_t)count[s] * SCALE) / symbols.size());
+        if(!freq[s]) freq[s] = 1;
+        total += freq[s];
+        if(count[s] > count[largest]) largest = s;
+        n_used++;
+    }
+    if((int64_t)freq[largest] + SCALE - (int64_t)total <= 0)
+        return false;
+    freq[largest] += SCALE - total;
+    if(freq[largest] > MAX_FREQ) {
+        int spare = (largest + 1) & 0xFF;
+        if(!freq[spare]) n_used++;
+        freq[spare] += freq[largest] - MAX_FREQ;
+        freq[largest] = MAX_FREQ;
+    }
+
+    cum[0] = 0;
+    for(int s = 0; s < 256; s++) cum[s+1] = cum[s] + freq[s];
+
+    putVarint(out, symbols.size());
+    putVarint(out, n_used);
+    for(int s = 0; s < 256; s++) {
+        if(!freq[s]) continue;
+        out.push_back((uint8_t)s);
+        putVarint(out, freq[s]);
+    }
+
+    //rANS writes backwards from the end of the buffer. Symbols alternate
+    //between two coders so that consecutive symbols do not wait on each other
+    //(the states are kept in locals: byte stores could alias an array)
+    coded.resize(symbols.size() + 16);
+    uint8_t *ptr = coded.data() + coded.size();
+    const uint8_t *limit = coded.data() + 8;
+    uint32_t x0 = RANS_L, x1 = RANS_L;
+    auto put = [&](uint32_t x, uint8_t s) -> uint32_t {
+        const uint32_t f = freq[s];
+        const uint32_t x_max = ((RANS_L >> SCALE_BITS) << 8) * f;
+        while(x >= x_max) {
+            *--ptr = (uint8_t)x;
+            x >>= 8;
+        }
+        return ((x / f) << SCALE_BITS) + (x % f) + cum[s];
+    };
+    for(size_t i = symbols.size(); i > 0; i--) {
+        if(i & 1) x0 = put(x0, symbols[i-1]);
+        else      x1 = put(x1, symbols[i-1]);
+        if(ptr < limit) return false; //no smaller than the input
+    }
+    for(uint32_t x : {x1, x0}) {
+        ptr -= 4;
+        ptr[0] = (uint8_t)x;
+        ptr[1] = (uint8_t)(x >> 8);
+        ptr[2] = (uint8_t)(x >> 16);
+        ptr[3] = (uint8_t)(x >> 24);
+    }
+
+    out.insert(out.end(), ptr, coded.data() + coded.size());
+    return true;
+}
+
+bool vPacketCompressor::entropyDecode(const uint8_t *&in, const uint8_t *end,
+                                      size_t n)
+{
+    uint32_t n_used, f;
+    if(!getVarint(in, end, n_used) || n_used == 0 || n_used > 256)
+        return false;
+
+    //each slot of the scale maps to its symbol, frequency and offset
+    decode_table.resize(SCALE);
+    uint32_t total = 0;
+    for(uint32_t i = 0; i < n_used; i++) {
+        if(in >= end) return false;
+        uint8_t s = *in++;
+        if(!getVarint(in, end, f) || !f || total + f > SCALE) return false;
+        for(uint32_t j = 0; j < f; j++)
+            decode_table[total + j] = {(uint16_t)f, (uint16_t)j, s};
+        total += f;
+    }
+    if(total != SCALE || end - in < 8) return false;
+
+    uint32_t x0 = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+    uint32_t x1 = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+    in += 8;
+
+    //the stream may be read past its end only if it is corrupt: reads are
+    //then replaced by zeros and the packet is rejected below
+    const slot *table = decode_table.data();
+    const uint8_t *ptr = in;
+    auto get = [&](uint32_t &x) -> uint8_t {
+        const slot d = table[x & (SCALE - 1)];
+        x = d.freq * (x >> SCALE_BITS) + d.offset;
+        while(x < RANS_L)
+            x = (x << 8) | (ptr < end ? *ptr : 0), ptr++;
+        return d.symbol;
+    };
+
+    symbols.resize(n);
+    uint8_t *out = symbols.data();
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2) {
+        out[i] = get(x0);
+        out[i+1] = get(x1);
+    }
+    if(i < n)
+        out[i] = get(x0);
+
+    in = ptr;
+    return ptr <= end;
+}
+
+unsigned int vPacketCompressor::compress(const int32_t *data,
+                                         unsigned int n_ints,
+                                         unsigned int row_ints,
+                                         std::vector<int32_t> &out)
+{
+    if(!row_ints || row_ints > MAX_ROW_INTS) row_ints = 1;
+    n_ints -= n_ints % row_ints;
+    transform(data, n_ints, row_ints);
+
+    packed.clear();
+    packed.push_back(FLAG_VERSION | FLAG_ENTROPY);
+    putVarint(packed, n_ints);
+    putVarint(packed, row_ints);
+    size_t header_bytes = packed.size();
+
+    if(!entropyEncode(packed) ||
+            packed.size() - header_bytes >= symbols.size()) {
+        packed.resize(header_bytes);
+        packed[0] = FLAG_VERSION;
+        packed.insert(packed.end(), symbols.begin(), symbols.end());
+    }
+
+    unsigned int n_out = (packed.size() + sizeof(int32_t) - 1) / sizeof(int32_t);
+    out.resize(n_out);
+    out.back() = 0;
+    std::memcpy(out.data(), packed.data(), packed.size());
+    return n_out;
+}
+
+bool vPacketCompressor::decompress(const int32_t *data, unsigned int n_ints,
+                                   std::vector<int32_t> &out)
+{
+    const uint8_t *in = (const uint8_t *)data;
+    const uint8_t *end = in + n_ints * sizeof(int32_t);
+    uint32_t raw_ints, row_ints, n_symbols;
+
+    if(in >= end || (*in & 0xF0) != FLAG_VERSION)
+        return false;
+    bool entropy = *in++ & FLAG_ENTROPY;
+    if(!getVarint(in, end, raw_ints) || !getVarint(in, end, row_ints) ||
+            !row_ints || row_ints > MAX_ROW_INTS || raw_ints > MAX_INTS)
+        return false;
+
+    //every int is at least one symbol
+    if(!entropy) {
+        if(raw_ints > (size_t)(end - in))
+            return false;
+        return untransform(in, end - in, raw_ints, row_ints, out);
+    }
+
+    //the transform makes at most 7 bytes per int (an address is 3 varints)
+    if(!getVarint(in, end, n_symbols) || n_symbols > 7 * (size_t)raw_ints ||
+            raw_ints > n_symbols ||
+            n_symbols > MAX_EXPANSION * (size_t)(end - in))
+        return false;
+    if(!entropyDecode(in, end, n_symbols))
+        return false;
+    return untransform(symbols.data(), symbols.size(), raw_ints, row_ints, out);
+}
+
+}
@@ -162,6 +162,28 @@ void isoDraw::initialise()
 
     }
 
+    //the projection is linear: the sensor position and the time offset can
+    //be projected separately and summed
+    proj_x.resize(Xlimit * Ylimit);
+    proj_y.resize(Xlimit * Ylimit);
+    for(int yi = 0; yi < Ylimit; yi++) {
+        for(int xi = 0; xi < Xlimit; xi++) {
+            proj_x[yi * Xlimit + xi] = xi * CY + 0.5;
+            proj_y[yi * Xlimit + xi] = yi * CX + xi * SX * SY + 0.5;
+        }
+    }
+
+    z_x.resize(Zlimit + 1);
+    z_y.resize(Zlimit + 1);
+    for(int zi = 0; zi <= Zlimit; zi++) {
+        z_x[zi] = zi * SY;
+        z_y[zi] = -zi * SX * CY;
+    }
+
+    density_pos = cv::Mat(imageheight, imagewidth, CV_32F);
+    density_neg = cv::Mat(imageheight, imagewidth, CV_32F);
+    isoimage = cv::Mat(imageheight, imagewidth, CV_8UC3);
+
     yInfo() << "Finished setting up ISO draw";
 
 
@@ -170,62 +192,81 @@ void isoDraw::initialise()
 
 void isoDraw::draw(cv::Mat &image, const ev::vQueue &eSet, int vTime)
 {
+    density_pos.setTo(0);
+    density_neg.setTo(0);
 
-    auto light_violet = (white - (white - violet) * 0.25);
-    auto light_aqua = (white - (white - aqua) * 0.25);
-
-    cv::Mat isoimage = baseimage.clone();
-    isoimage.setTo(255);
-
-    //if() return;
     if(!eSet.empty() && vTime < 0)
         vTime = eSet.back()->stamp;
 
-    int skip = 1 + eSet.size() / 100000;
-
-    for(int i = eSet.size() - 1; i >= 0; i -= skip) {
+    //accumulate every event in the window into the density buffers
+    for(auto qi = eSet.rbegin(); qi != eSet.rend(); qi++) {
 
-        AE *aep = read_as<AE>(eSet[i]);
+        AE *aep = read_as<AE>(*qi);
 
-        //transform values
         int dt = vTime - aep->stamp;
         if(dt < 0) dt += ev::vtsHelper::max_stamp;
-        if((unsigned int)dt > max_window) continue;
-        dt = dt * ts_to_axis + 0.5;
+        if((unsigned int)dt > max_window) break;
+        int pz = std::min((int)(dt * ts_to_axis + 0.5), Zlimit);
+
         int px = aep->x;
         int py = aep->y;
         if(flip) {
             px = Xlimit - 1 - px;
             py = Ylimit - 1 - py;
         }
-        int pz = dt;
-        pttr(px, py, pz);
-        px += imagexshift;
-        py += imageyshift;
+        if(px < 0 || px >= Xlimit || py < 0 || py >= Ylimit)
+            continue;
 
-        if(px < 0 || px >= imagewidth || py < 0 || py >= imageheight) {
+        int i = py * Xlimit + px;
+        px = (int)(proj_x[i] + z_x[pz]) + imagexshift;
+        py = (int)(proj_y[i] + z_y[pz]) + imageyshift;
+        if(px < 0 || px >= imagewidth || py < 0 || py >= imageheight)
             continue;
-        }
 
-        if(!aep->polarity) {
-            isoimage.at<cv::Vec3b>(py, px) = light_violet;
-        } else {
-            isoimage.at<cv::Vec3b>(py, px) = light_aqua;
+        if(aep->polarity)
+            density_pos.at<float>(py, px) += 1.0f;
+        else
+            density_neg.at<float>(py, px) += 1.0f;
+    }
+
+    //tone-map: a single event is drawn lightly and the colour saturates
+    //logarithmically with the density. The colour blends between the
+    //polarities.
+    cv::Mat log_density = density_pos + density_neg + 1.0;
+    cv::log(log_density, log_density);
+    double max_log = 0;
+    cv::minMaxLoc(log_density, nullptr, &max_log);
+    const float log_one = std::log(2.0f);
+    float scale = max_log > log_one ? 0.75f / (max_log - log_one) : 0.0f;
+
+    for(int y = 0; y < imageheight; y++) {
+        const float *dp = density_pos.ptr<float>(y);
+        const float *dn = density_neg.ptr<float>(y);
+        const float *ld = log_density.ptr<float>(y);
+        cv::Vec3b *c = isoimage.ptr<cv::Vec3b>(y);
+        for(int x = 0; x < imagewidth; x++) {
+            float alpha = ld[x] > 0.0f ? 0.25f + scale * (ld[x] - log_one) : 0.0f;
+            float fp = dp[x] / (dp[x] + dn[x] + 1e-6f);
+            for(int k = 0; k < 3; k++) {
+                float pc = fp * aqua[k] + (1.0f - fp) * violet[k];
+                c[x][k] = cv::saturate_cast<uchar>(255.0f - alpha * (255.0f - pc));
+            }
         }
     }
 
     if (image.type() == CV_8UC1)
         cv::cvtColor(image, image, cv::COLOR_GRAY2RGB);
     if(!image.empty()) {
-        for(int y = 0; y < image.rows; y++) {
-            for(int x = 0; x < image.cols; x++) {
+        int rows = std::min(image.rows, Ylimit);
+        int cols = std::min(image.cols, Xlimit);
+        for(int y = 0; y < rows; y++) {
+            for(int x = 0; x < cols; x++) {
                 cv::Vec3b &pixel = image.at<cv::Vec3b>(y, x);
 
                 if(pixel[0] != 255 || pixel[1] != 255 || pixel[2] != 255) {
 
-                    int px = x, py = y, pz = 0; pttr(px, py, pz);
-                    px += imagexshift;
-                    py += imageyshift;
+                    int px = (int)proj_x[y * Xlimit + x] + imagexshift;
+                    int py = (int)proj_y[y * Xlimit + x] + imageyshift;
                     if(px < 0 || px >= imagewidth || py < 0 || py >= imageheight)
                         continue;
 
@@ -235,7 +276,7 @@ void isoDraw::draw(cv::Mat &image, const ev::vQueue &eSet, int vTime)
         }
     }
 
-    image = isoimage - baseimage;
+    cv::subtract(isoimage, baseimage, image);
 
 }
 
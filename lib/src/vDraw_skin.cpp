@@ -50,6 +50,11 @@ void skinDraw::draw(cv::Mat &image, const ev::vQueue &eSet, int vTime)
 
     if(eSet.empty()) return;
 
+    if(image.size() != baseimage.size() || image.type() != baseimage.type())
+        return;
+
+    //only the newest event of each taxel is drawn, as a pre-rendered sprite
+    frame++;
     ev::vQueue::const_reverse_iterator qi;
     for(qi = eSet.rbegin(); qi != eSet.rend(); qi++) {
 
@@ -61,29 +66,12 @@ void skinDraw::draw(cv::Mat &image, const ev::vQueue &eSet, int vTime)
 
         auto aep = is_event<SkinEvent>(*qi);
 
-        int index = aep->taxel;
-
-
-        if(tmap.pos.find(index) != tmap.pos.end()){
-            //yInfo() << "\n Index " << index <<"  mapped to   "<< std :: get<0>(tmap[index]) << std :: get<1>(tmap[index]) << "\n";
-            int x = tmap.xoffset + tmap.scaling* std :: get<0>(tmap.pos[index]);
-            int y =  tmap.yoffset + tmap.scaling* std :: get<1>(tmap.pos[index]);
-            cv::Point centr(x, y);
-            if(!aep->polarity)
-            {
-                cv::circle(image, centr, radius, aqua, cv::FILLED, cv::LINE_AA);
-            }
-            else
-            {
-                cv::circle(image, centr, radius, violet, cv::FILLED, cv::LINE_AA);
-            }
-        }
-        else
-        {
-           // yWarning() << "\n Index " << index <<"not mapped! \n";
-        }
-
+        unsigned int index = aep->taxel;
+        if(!sprites.mapped(index) || last_frame[index] == frame)
+            continue;
 
+        last_frame[index] = frame;
+        sprites.blit(image, index, aep->polarity);
     }
 }
 
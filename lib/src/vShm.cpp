@@ -0,0 +1,398 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/vShm.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+namespace ev {
+
+static const std::uint32_t SHM_MAGIC = 0x65767368; //"evsh"
+
+struct vShmRing::header {
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t n_slots;
+    std::uint64_t capacity;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    std::atomic<std::uint64_t> published;  //number of the newest packet
+    std::atomic<std::uint64_t> valid_from; //oldest ring position not overwritten
+    std::uint64_t write_pos;
+    std::atomic<std::uint32_t> alive;
+    std::uint64_t generation; //<- differs for every ring created
+    std::int32_t pid;         //<- of the writer
+};
+
+struct vShmRing::slot {
+    std::atomic<std::uint64_t> seq;
+    char type[24];
+    std::uint64_t pos;
+    std::uint32_t bytes;
+    std::int32_t stamp_count;
+    double stamp_time;
+};
+
+static size_t align64(size_t bytes)
+{
+    return (bytes + 63) & ~(size_t)63;
+}
+
+static void robustRecover(pthread_mutex_t *mutex)
+{
+#if defined(_POSIX_THREAD_ROBUST_PRIO_INHERIT)
+    pthread_mutex_consistent(mutex);
+#else
+    (void)mutex;
+#endif
+}
+
+//a process killed while holding the lock leaves it to the next locker, which
+//makes it consistent again (the state it protects is only the condition)
+static void robustLock(pthread_mutex_t *mutex)
+{
+    if(pthread_mutex_lock(mutex) == EOWNERDEAD)
+        robustRecover(mutex);
+}
+
+vShmRing::vShmRing()
+{
+    hdr = nullptr;
+    slots = nullptr;
+    ring = nullptr;
+    mapped_bytes = 0;
+    capacity = 0;
+    n_slots = 0;
+    generation = 0;
+    device = inode = 0;
+    owner = false;
+}
+
+vShmRing::~vShmRing()
+{
+    close();
+}
+
+std::string vShmRing::segmentName(const std::string &port_name)
+{
+    std::string segment = "/ev" + port_name;
+    for(size_t i = 1; i < segment.size(); i++)
+        if(segment[i] == '/') segment[i] = '_';
+    return segment;
+}
+
+bool vShmRing::map(int fd, size_t bytes)
+{
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) == 0) {
+        device = st.st_dev;
+        inode = st.st_ino;
+    }
+    mapped_bytes = bytes;
+    hdr = (header *)p;
+    slots = (slot *)((char *)p + align64(sizeof(header)));
+    return true;
+}
+
+bool vShmRing::create(const std::string &port_name, size_t bytes,
+                      unsigned int slot_count)
+{
+    close();
+    name = segmentName(port_name);
+
+    //a ring left behind by a writer that did not close cleanly
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0)
+        return false;
+
+    bytes = align64(bytes);
+    n_slots = slot_count;
+    size_t total = align64(sizeof(header)) + align64(n_slots * sizeof(slot))
+            + bytes;
+    if(ftruncate(fd, total) < 0 || !map(fd, total)) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        hdr = nullptr;
+        return false;
+    }
+    ::close(fd);
+    owner = true;
+
+    new (hdr) header;
+    hdr->n_slots = n_slots;
+    hdr->capacity = bytes;
+    capacity = bytes;
+    hdr->published = 0;
+    hdr->valid_from = 0;
+    hdr->write_pos = 0;
+    hdr->alive = 1;
+    hdr->pid = getpid();
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    hdr->generation = ((std::uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec)
+            ^ ((std::uint64_t)hdr->pid << 32);
+    generation = hdr->generation;
+
+    pthread_mutexattr_t mattr;
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+#if defined(_POSIX_THREAD_ROBUST_PRIO_INHERIT)
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&hdr->mutex, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&hdr->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    for(unsigned int i = 0; i < n_slots; i++)
+        new (slots + i) slot{{0}, {0}, 0, 0, 0, 0.0};
+    ring = (char *)slots + align64(n_slots * sizeof(slot));
+
+    hdr->magic.store(SHM_MAGIC, std::memory_order_release);
+    return true;
+}
+
+bool vShmRing::attach(const std::string &port_name)
+{
+    close();
+    name = segmentName(port_name);
+
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < align64(sizeof(header)) ||
+            !map(fd, st.st_size)) {
+        ::close(fd);
+        hdr = nullptr;
+        return false;
+    }
+    ::close(fd);
+    owner = false;
+
+    //the ring must fit in what was mapped
+    n_slots = hdr->n_slots;
+    capacity = hdr->capacity;
+    size_t ring_offset = align64(sizeof(header)) + align64((size_t)n_slots * sizeof(slot));
+    if(hdr->magic.load(std::memory_order_acquire) != SHM_MAGIC || !n_slots ||
+            !capacity || ring_offset > mapped_bytes ||
+            capacity > mapped_bytes - ring_offset) {
+        close();
+        return false;
+    }
+    ring = (char *)slots + align64(n_slots * sizeof(slot));
+    generation = hdr->generation;
+    return true;
+}
+
+bool vShmRing::replaced() const
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0600);
+    if(fd < 0)
+        return true;
+
+    //an inode may be reused once a segment is removed: the generation tells
+    //the rings apart
+    struct stat st;
+    bool same = fstat(fd, &st) == 0 && st.st_dev == (dev_t)device &&
+            st.st_ino == (ino_t)inode && (size_t)st.st_size >= sizeof(header);
+    if(same) {
+        void *p = mmap(nullptr, sizeof(header), PROT_READ, MAP_SHARED, fd, 0);
+        same = p != MAP_FAILED &&
+                ((const header *)p)->generation == generation;
+        if(p != MAP_FAILED)
+            munmap(p, sizeof(header));
+    }
+    ::close(fd);
+    return !same;
+}
+
+void vShmRing::close()
+{
+    if(!hdr) return;
+
+    if(owner) {
+        hdr->alive = 0;
+        wake();
+    }
+    //a writer that was replaced must not remove the new ring
+    if(owner && !replaced())
+        shm_unlink(name.c_str());
+    munmap(hdr, mapped_bytes);
+
+    hdr = nullptr;
+    slots = nullptr;
+    ring = nullptr;
+    capacity = 0;
+    n_slots = 0;
+    owner = false;
+}
+
+bool vShmRing::writerAlive() const
+{
+    if(!hdr || !hdr->alive.load())
+        return false;
+    if(owner)
+        return true;
+
+    //a writer that crashed leaves alive set: check the process, and that a
+    //restarted writer has not replaced the ring under the same name
+    if(kill(hdr->pid, 0) < 0 && errno == ESRCH)
+        return false;
+    return !replaced();
+}
+
+bool vShmRing::publish(const std::string &type, const char *block,
+                       size_t bytes, double stamp_time, int stamp_count)
+{
+    if(!hdr || !owner || bytes > capacity)
+        return false;
+
+    //packets are kept contiguous, skipping the end of the ring if needed
+    std::uint64_t pos = hdr->write_pos;
+    if(pos % capacity + bytes > capacity)
+        pos += capacity - pos % capacity;
+    std::uint64_t end = pos + bytes;
+
+    //readers must see the invalidation before any data changes
+    if(end > capacity && end - capacity > hdr->valid_from.load(std::memory_order_relaxed))
+        hdr->valid_from.store(end - capacity, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(ring + pos % capacity, block, bytes);
+
+    std::uint64_t seq = hdr->published.load(std::memory_order_relaxed) + 1;
+    slot &s = slots[(seq - 1) % n_slots];
+    s.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::strncpy(s.type, type.c_str(), sizeof(s.type) - 1);
+    s.type[sizeof(s.type) - 1] = '\0';
+    s.pos = pos;
+    s.bytes = bytes;
+    s.stamp_time = stamp_time;
+    s.stamp_count = stamp_count;
+    s.seq.store(seq, std::memory_order_release);
+
+    hdr->write_pos = end;
+    hdr->published.store(seq, std::memory_order_release);
+    wake();
+    return true;
+}
+
+std::uint64_t vShmRing::wait(std::uint64_t seq, double timeout)
+{
+    if(!hdr) return seq;
+
+    std::uint64_t latest = hdr->published.load(std::memory_order_acquire);
+    if(latest > seq || !hdr->alive.load())
+        return latest;
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    long ns = until.tv_nsec + (long)(timeout * 1e9);
+    until.tv_sec += ns / 1000000000L;
+    until.tv_nsec = ns % 1000000000L;
+
+    robustLock(&hdr->mutex);
+    while(hdr->published.load(std::memory_order_acquire) <= seq &&
+          hdr->alive.load()) {
+        int r = pthread_cond_timedwait(&hdr->cond, &hdr->mutex, &until);
+        if(r == EOWNERDEAD)
+            robustRecover(&hdr->mutex);
+        else if(r)
+            break;
+    }
+    pthread_mutex_unlock(&hdr->mutex);
+
+    return hdr->published.load(std::memory_order_acquire);
+}
+
+void vShmRing::wake()
+{
+    if(!hdr) return;
+    robustLock(&hdr->mutex);
+    pthread_cond_broadcast(&hdr->cond);
+    pthread_mutex_unlock(&hdr->mutex);
+}
+
+bool vShmRing::peek(std::uint64_t &seq, packet &p, unsigned int &lost) const
+{
+    if(!hdr) return false;
+
+    std::uint64_t latest = hdr->published.load(std::memory_order_acquire);
+    while(seq <= latest) {
+
+        //the reader is more than a ring behind
+        if(latest - seq >= n_slots) {
+            lost += latest - n_slots + 1 - seq;
+            seq = latest - n_slots + 1;
+        }
+
+        const slot &s = slots[(seq - 1) % n_slots];
+        std::uint64_t before = s.seq.load(std::memory_order_acquire);
+        std::memcpy(p.type, s.type, sizeof(p.type));
+        p.type[sizeof(p.type) - 1] = '\0';
+        p.pos = s.pos;
+        std::uint64_t bytes = s.bytes;
+        p.ints = bytes / sizeof(std::int32_t);
+        p.stamp_time = s.stamp_time;
+        p.stamp_count = s.stamp_count;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        //a packet that does not lie within the ring is never returned
+        bool in_ring = bytes <= capacity && p.pos % capacity + bytes <= capacity;
+        if(before == seq && s.seq.load(std::memory_order_relaxed) == seq &&
+                in_ring && stillValid(p)) {
+            p.seq = seq;
+            p.data = (const std::int32_t *)(ring + p.pos % capacity);
+            return true;
+        }
+
+        //overwritten before we got to it
+        lost++;
+        seq++;
+    }
+
+    return false;
+}
+
+bool vShmRing::stillValid(const packet &p) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return hdr->valid_from.load(std::memory_order_relaxed) <= p.pos;
+}
+
+}
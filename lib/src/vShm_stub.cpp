@@ -0,0 +1,84 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "event-driven/vShm.h"
+
+namespace ev {
+
+// no POSIX shared memory on this system: a ring is never opened, and the
+// ports fall back to YARP alone
+
+struct vShmRing::header {};
+struct vShmRing::slot {};
+
+vShmRing::vShmRing()
+{
+    hdr = nullptr;
+    slots = nullptr;
+    ring = nullptr;
+    mapped_bytes = 0;
+    capacity = 0;
+    n_slots = 0;
+    generation = 0;
+    device = inode = 0;
+    owner = false;
+}
+
+vShmRing::~vShmRing() {}
+
+std::string vShmRing::segmentName(const std::string &port_name)
+{
+    std::string segment = "/ev" + port_name;
+    for(size_t i = 1; i < segment.size(); i++)
+        if(segment[i] == '/') segment[i] = '_';
+    return segment;
+}
+
+bool vShmRing::map(int, size_t) { return false; }
+
+bool vShmRing::create(const std::string &, size_t, unsigned int)
+{
+    return false;
+}
+
+bool vShmRing::attach(const std::string &) { return false; }
+
+bool vShmRing::replaced() const { return true; }
+
+void vShmRing::close() {}
+
+bool vShmRing::writerAlive() const { return false; }
+
+bool vShmRing::publish(const std::string &, const char *, size_t, double, int)
+{
+    return false;
+}
+
+std::uint64_t vShmRing::wait(std::uint64_t seq, double) { return seq; }
+
+void vShmRing::wake() {}
+
+bool vShmRing::peek(std::uint64_t &, packet &, unsigned int &) const
+{
+    return false;
+}
+
+bool vShmRing::stillValid(const packet &) const { return false; }
+
+}
@@ -0,0 +1,260 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "event-driven/vTrace.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ev {
+
+// ========================================================================== //
+// vLatencyHistogram
+
+//the index of the highest set bit (v > 0)
+static inline int highestBit(std::uint64_t v)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return (int)i;
+#elif defined(__GNUC__)
+    return 63 - __builtin_clzll(v);
+#else
+    int m = 0;
+    while(v >>= 1) m++;
+    return m;
+#endif
+}
+
+int vLatencyHistogram::bucketOf(std::uint64_t us)
+{
+    if(us < (1u << SUB_BITS))
+        return (int)us;
+    int m = highestBit(us);
+    int bucket = ((m - SUB_BITS + 1) << SUB_BITS) +
+            (int)((us >> (m - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+    return std::min(bucket, N_BUCKETS - 1);
+}
+
+double vLatencyHistogram::bucketMiddle(int bucket)
+{
+    int mag = bucket >> SUB_BITS;
+    int sub = bucket & ((1 << SUB_BITS) - 1);
+    if(!mag)
+        return sub;
+    double width = (double)(1ull << (mag - 1));
+    return ((1 << SUB_BITS) + sub) * width + 0.5 * width;
+}
+
+void vLatencyHistogram::record(double seconds)
+{
+    std::uint64_t us = seconds > 0 ? (std::uint64_t)(seconds * 1e6) : 0;
+    us = std::min<std::uint64_t>(us, 0xFFFFFFFFull);
+
+    buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    n.fetch_add(1, std::memory_order_relaxed);
+    total_us.fetch_add(us, std::memory_order_relaxed);
+
+    std::uint64_t prev = max_us.load(std::memory_order_relaxed);
+    while(us > prev &&
+          !max_us.compare_exchange_weak(prev, us, std::memory_order_relaxed));
+}
+
+void vLatencyHistogram::reset()
+{
+    for(auto &b : buckets)
+        b.store(0, std::memory_order_relaxed);
+    n = 0;
+    total_us = 0;
+    max_us = 0;
+}
+
+double vLatencyHistogram::mean() const
+{
+    std::uint64_t count = n;
+    return count ? 1e-6 * total_us / count : 0.0;
+}
+
+double vLatencyHistogram::max() const
+{
+    return 1e-6 * max_us;
+}
+
+double vLatencyHistogram::percentile(double p) const
+{
+    //the buckets are read one by one while others may be recording: the
+    //total is taken from the buckets themselves so the result is consistent
+    std::uint32_t counts[N_BUCKETS];
+    std::uint64_t total = 0;
+    for(int i = 0; i < N_BUCKETS; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if(!total)
+        return 0.0;
+
+    std::uint64_t target = std::max<std::uint64_t>(1, (std::uint64_t)(p * total + 0.5));
+    std::uint64_t seen = 0;
+    for(int i = 0; i < N_BUCKETS; i++) {
+        seen += counts[i];
+        if(seen >= target)
+            return 1e-6 * std::min<double>(bucketMiddle(i), max_us);
+    }
+    return max();
+}
+
+void vLatencyHistogram::addTo(yarp::os::Bottle &b) const
+{
+    b.addInt((int)count());
+    b.addDouble(1e3 * mean());
+    b.addDouble(1e3 * percentile(0.5));
+    b.addDouble(1e3 * percentile(0.9));
+    b.addDouble(1e3 * percentile(0.99));
+    b.addDouble(1e3 * max());
+}
+
+// ========================================================================== //
+// vTrace
+
+namespace {
+
+class statsPublisher : public yarp::os::RateThread
+{
+public:
+
+    std::mutex m;
+    std::vector<vPortTrace *> traces;
+    std::string port_name;
+    yarp::os::BufferedPort<yarp::os::Bottle> port;
+
+    statsPublisher() : RateThread(1000) {}
+
+    void openPort()
+    {
+        if(port_name.empty())
+            return;
+        if(!port.open(port_name)) {
+            yWarning() << "Could not open" << port_name;
+            return;
+        }
+        start();
+    }
+
+    //run() takes the lock so it must be free to stop the thread
+    void closePort()
+    {
+        if(isRunning())
+            stop();
+        port.close();
+    }
+
+    yarp::os::Bottle stats()
+    {
+        yarp::os::Bottle b;
+        std::lock_guard<std::mutex> lock(m);
+        for(auto t : traces) {
+            yarp::os::Bottle &entry = b.addList();
+            entry.addString(t->name);
+            yarp::os::Bottle &latency = entry.addList();
+            latency.addString("latency");
+            t->latency.addTo(latency);
+            yarp::os::Bottle &queue = entry.addList();
+            queue.addString("queue");
+            t->queue.addTo(queue);
+            yarp::os::Bottle &process = entry.addList();
+            process.addString("process");
+            t->process.addTo(process);
+        }
+        return b;
+    }
+
+    void run()
+    {
+        if(!port.getOutputCount())
+            return;
+        yarp::os::Bottle &b = port.prepare();
+        b = stats();
+        port.write();
+    }
+};
+
+statsPublisher &publisher()
+{
+    static statsPublisher p;
+    return p;
+}
+
+}
+
+void vTrace::setStatsPort(const std::string &name)
+{
+    statsPublisher &p = publisher();
+    p.closePort();
+    std::lock_guard<std::mutex> lock(p.m);
+    p.port_name = name;
+    if(p.traces.size())
+        p.openPort();
+}
+
+void vTrace::setPeriod(double seconds)
+{
+    publisher().setRate(1000.0 * seconds);
+}
+
+void vTrace::add(vPortTrace *trace)
+{
+    statsPublisher &p = publisher();
+    std::lock_guard<std::mutex> lock(p.m);
+    p.traces.push_back(trace);
+    if(p.traces.size() == 1)
+        p.openPort();
+}
+
+void vTrace::remove(vPortTrace *trace)
+{
+    statsPublisher &p = publisher();
+    std::unique_lock<std::mutex> lock(p.m);
+    p.traces.erase(std::remove(p.traces.begin(), p.traces.end(), trace),
+                   p.traces.end());
+    if(p.traces.size())
+        return;
+    lock.unlock();
+    p.closePort();
+}
+
+yarp::os::Bottle vTrace::stats()
+{
+    return publisher().stats();
+}
+
+void vTrace::reset()
+{
+    statsPublisher &p = publisher();
+    std::lock_guard<std::mutex> lock(p.m);
+    for(auto t : p.traces) {
+        t->latency.reset();
+        t->queue.reset();
+        t->process.reset();
+    }
+}
+
+}
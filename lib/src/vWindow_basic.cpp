@@ -188,4 +188,95 @@ vQueue vTempWindow::getWindow()
 }
 
 
+/******************************************************************************/
+
+vPacketWindow::vPacketWindow(unsigned int window)
+{
+    ring.resize(64);
+    head = 0;
+    count = 0;
+    newest = -1;
+    this->window = window;
+}
+
+void vPacketWindow::setWindow(unsigned int window)
+{
+    this->window = window;
+    trim();
+}
+
+void vPacketWindow::clear()
+{
+    q.clear();
+    head = 0;
+    count = 0;
+    newest = -1;
+}
+
+unsigned int vPacketWindow::age(int stamp) const
+{
+    int dt = newest - stamp;
+    if(dt < 0) dt += vtsHelper::max_stamp;
+    return dt;
+}
+
+void vPacketWindow::pushPacket(unsigned int n, int last)
+{
+    //grow the circular buffer keeping the packets in order
+    if(count == ring.size()) {
+        std::vector<packet> bigger(ring.size() * 2);
+        for(unsigned int i = 0; i < count; i++)
+            bigger[i] = ring[(head + i) % ring.size()];
+        ring.swap(bigger);
+        head = 0;
+    }
+
+    ring[(head + count) % ring.size()] = {n, last};
+    count++;
+    newest = last;
+}
+
+void vPacketWindow::trim()
+{
+    if(!window) return;
+
+    //whole packets are removed based only on their most recent event
+    unsigned int n_remove = 0;
+    while(count > 1 && age(ring[head].last) > window) {
+        n_remove += ring[head].n;
+        head = (head + 1) % ring.size();
+        count--;
+    }
+    if(n_remove)
+        q.erase(q.begin(), q.begin() + n_remove);
+
+    //the boundary packet is trimmed per event
+    while(count && q.size() && age(q.front()->stamp) > window) {
+        q.pop_front();
+        if(!--ring[head].n) {
+            head = (head + 1) % ring.size();
+            count--;
+        }
+    }
+}
+
+void vPacketWindow::addPacket(const vQueue &packet)
+{
+    if(packet.empty()) return;
+    q.insert(q.end(), packet.begin(), packet.end());
+    pushPacket(packet.size(), packet.back()->stamp);
+    trim();
+}
+
+void vPacketWindow::addPacket(vQueue &&packet)
+{
+    if(packet.empty()) return;
+    int last = packet.back()->stamp;
+    q.insert(q.end(), std::make_move_iterator(packet.begin()),
+             std::make_move_iterator(packet.end()));
+    pushPacket(packet.size(), last);
+    packet.clear();
+    trim();
+}
+
 }
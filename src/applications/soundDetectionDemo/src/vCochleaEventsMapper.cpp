@@ -20,6 +20,7 @@
 #include <event-driven/all.h>
 #include "event-driven/vDraw.h"
 #include <limits.h>
+#include <mutex>
 
 using namespace ev;
 using namespace yarp::os;
@@ -46,20 +47,33 @@ private:
     // Period
     double update_period;
 
-    // Matrix of coincidence counters from MSO
+    // Counters of every output address: the NAS histogram is the range
+    // [0, nas_addrresses_offset) and the MSO coincidence counters follow.
+    // The last bin collects unrecognised addresses.
     // ----------------------------------------------------------------------------
-    // WARNING!! This matrix should have the same dimensions as the MSO model
+    // WARNING!! The MSO part should have the same dimensions as the MSO model
     // used in the VHDL model
     // ----------------------------------------------------------------------------
-    int mso_histogram[cochleaHelper::mso_num_freq_channels][cochleaHelper::mso_num_neurons_per_channel];
+    std::vector<int> histogram;
+    std::mutex histogram_mutex;
+
+    // MSO winner, maintained as events are counted
+    int mso_max_value;
+    int mso_max_address;
+
+    int mso_histogram(int ch, int ne) {
+        return histogram[cochleaHelper::nas_addrresses_offset + ch * cochleaHelper::mso_num_neurons_per_channel + ne];
+    }
 
     // Visualizer output image
     int image_mso_heatmap_width = 320;
     int image_mso_heatmap_height = 240;
     cv::Mat image_mso_heatmap = cv::Mat::zeros(cv::Size(image_mso_heatmap_width,image_mso_heatmap_height), CV_8UC3);
 
-    // Array of freq. channels activity
-    int nas_histogram[cochleaHelper::nas_addrresses_offset];
+    // Freq. channels activity
+    int nas_histogram(int i) {
+        return histogram[i];
+    }
 
     // Visualizer output image NAS 
     int image_nas_histogram_width = 320;
@@ -77,6 +91,10 @@ public:
         // Set the module name used to name ports
         setName((rf.check("name", Value("/vCochleaEventsMapper")).asString()).c_str());
 
+        //publish the latency histograms of the input ports
+        if(rf.check("stats") && rf.check("stats", Value(true)).asBool())
+            vTrace::setStatsPort(getName("/stats:o"));
+
         // Open input port
         yInfo() << "Opening input port...";
         if(!input_port.open(getName() + "/CochleaEvent:i")) {
@@ -109,23 +127,10 @@ public:
                                     Value(default_update_period)).asDouble();
         yInfo() << "Setting update_period parameter to: " << update_period;
 
-        // Initialize the MSO coincidence counters to zero
-        // ----------------------------------------------------------------------------
-        // WARNING!! This values should match with the ones used before
-        // ----------------------------------------------------------------------------
-        for(int i = 0; i < cochleaHelper::mso_num_freq_channels; i++) {
-            for(int j = 0; j < cochleaHelper::mso_num_neurons_per_channel; j++) {
-                mso_histogram[i][j] = 0;
-            }
-        }
-
-        // Initialize the NAS histogram
-        // ----------------------------------------------------------------------------
-        // WARNING!! This values should match with the ones used before
-        // ----------------------------------------------------------------------------
-        for(int i = 0; i < cochleaHelper::nas_addrresses_offset; i++) {
-            nas_histogram[i] = 0;
-        }
+        // Initialize the NAS histogram and MSO coincidence counters to zero
+        histogram.assign(cochleaHelper::max_num_addresses + 1, 0);
+        mso_max_value = 0;
+        mso_max_address = cochleaHelper::nas_addrresses_offset;
 
         // Do any other set-up required here
 
@@ -176,22 +181,17 @@ public:
         // ----------------------------------------------------------------------------
         // NOTE: The normalization is used also for generate the color code for the heatmap
         // ----------------------------------------------------------------------------
-        float max = 0.0f;
+        std::lock_guard<std::mutex> lock(histogram_mutex);
+
+        // The maximum is maintained as the events are counted
+        float max = (float)mso_max_value;
         float min = FLT_MAX;
-        int max_position_i = 0;
-        int max_position_j = 0;
+        int max_position_i = (mso_max_address - cochleaHelper::nas_addrresses_offset) / cochleaHelper::mso_num_neurons_per_channel;
+        int max_position_j = (mso_max_address - cochleaHelper::nas_addrresses_offset) % cochleaHelper::mso_num_neurons_per_channel;
 
         for(int i = 0; i < cochleaHelper::mso_num_freq_channels; i++) {
             for(int j = 0; j < cochleaHelper::mso_num_neurons_per_channel; j++) {
-                float val = (float)(mso_histogram[i][j]);
-                if(val > max){
-                    max = val;
-                    max_position_i = i;
-                    max_position_j = j;
-                }
-                if(val < min){
-                    min = val;
-                }
+                min = std::min(min, (float)mso_histogram(i, j));
             }
         }
 
@@ -201,7 +201,7 @@ public:
         for(int i = 0; i < cochleaHelper::mso_num_freq_channels; i++) {
             for(int j = 0; j < cochleaHelper::mso_num_neurons_per_channel; j++) {
                 
-                float pixelValue = (float)(mso_histogram[i][j]);
+                float pixelValue = (float)(mso_histogram(i, j));
                 float value = ((pixelValue - min) / (max - min));
 
                 int aR = 0;   int aG = 0; int aB = 255;     // RGB for our 1st color (blue in this case).
@@ -228,13 +228,6 @@ public:
         // Show the image
         cv::imshow("mso_heatmap", image_mso_heatmap);
 
-        // Clean the mso matrix values before the next update
-        for(int i = 0; i < cochleaHelper::mso_num_freq_channels; i++) {
-            for(int j = 0; j < cochleaHelper::mso_num_neurons_per_channel; j++) {
-                mso_histogram[i][j] = 0;
-            }
-        }
-
         // ----------------------------------------------------------------------------
         //                          HISTOGRAM DRAW SECTION
         // ----------------------------------------------------------------------------
@@ -258,7 +251,7 @@ public:
         float min_nas = 100000.0f;
 
         for(int i = 0; i < cochleaHelper::nas_addrresses_offset; i++) {
-            float val = (float)(nas_histogram[i]);
+            float val = (float)(nas_histogram(i));
             if(val > max_nas){
                 max_nas = val;
             }
@@ -271,7 +264,7 @@ public:
         //                          HISTOGRAM DRAW
         for(int i = 0; i < cochleaHelper::nas_addrresses_offset; i++) {
             // First, get the normalized value of the neuron activity
-            float normalized_histogram_value = (nas_histogram[i] - min_nas) * 100.0 / (max_nas - min_nas);
+            float normalized_histogram_value = (nas_histogram(i) - min_nas) * 100.0 / (max_nas - min_nas);
             
             // Define left top point
             float rec_x_top_left = i * bar_width;
@@ -295,10 +288,10 @@ public:
         // waitKey function call for both mso_heatmap and nas_histogram plots
         cv::waitKey(10);
 
-        // Clear the NAS histogram
-        for(int i = 0; i < cochleaHelper::nas_addrresses_offset; i++) {
-            nas_histogram[i] = 0;
-        }
+        // Clear the NAS histogram and the MSO matrix before the next update
+        std::fill(histogram.begin(), histogram.end(), 0);
+        mso_max_value = 0;
+        mso_max_address = cochleaHelper::nas_addrresses_offset;
 
         // Do any other set-up required here
 
@@ -310,15 +303,13 @@ public:
     {
         // YARP timestamp
         Stamp yarpstamp;
-        
-        // Output queue: type AE
-        deque<AE> out_queue;
 
-        // Output event: type AE
-        AE out_event;
+        // Output queue: type AE
+        vector<AE> out_queue;
 
-        // Raw address received from the input port
-        int address = 0;
+        const unsigned int max_address = cochleaHelper::max_num_addresses;
+        const unsigned int mso_first = cochleaHelper::nas_addrresses_offset;
+        const unsigned int mso_last = mso_first + cochleaHelper::mso_addresses_offset;
 
         // Forever...
         while(true) {
@@ -326,70 +317,57 @@ public:
             const vector<CochleaEvent> * q = input_port.read(yarpstamp);
             if(!q || Thread::isStopping()) return;
 
-            // Do asynchronous processing here
+            out_queue.resize(q->size());
+            size_t n_out = 0;
+            size_t n_invalid = 0;
+
+            histogram_mutex.lock();
+
+            // Single pass over the packet: the address comes from a lookup
+            // table and the events are kept or dropped by advancing the
+            // output index by the validity flag
             for(auto &qi : *q) {
 
-                // Get the real AER address
-                address = cochleaHelper::getAddress(qi);
+                uint32_t word = qi._cochleaei;
+                int address = cochleaHelper::getAddress(word);
+                unsigned int valid = (unsigned int)address < max_address;
+                unsigned int is_mso = (word >> 9 & 0x01) & ~(word >> 8) & 0x01;
+
+                // With SpiNNaker the output is the raw address, otherwise it
+                // is the neuron ID of MSO events
+                AE &out_event = out_queue[n_out];
+                out_event._coded_data = with_spinnaker ? address : qi.neuron_id;
+                out_event.stamp = qi.stamp;
+                n_out += with_spinnaker ? valid : is_mso;
+                n_invalid += !valid;
+
+                // Count the event, unrecognised addresses go to the last bin
+                unsigned int bin = valid ? address : max_address;
+                int count = ++histogram[bin];
+
+                // Keep track of the MSO winner
+                bool mso_bin = bin >= mso_first && bin < mso_last;
+                bool winner = mso_bin && count > mso_max_value;
+                mso_max_value = winner ? count : mso_max_value;
+                mso_max_address = winner ? bin : mso_max_address;
+            }
 
-                // If debug flag enabled, print it out
-                if (is_debug_flag == true) {
-                    yDebug() << "Event received and decoded address: " << address;
-                }
-                
-                // Check if SpiNNaker is available
-                if(with_spinnaker == true){
-                    // If the received event is valid
-                    if (address >= 0 && address < cochleaHelper::max_num_addresses) {
-                        // Copy the address to the raw int32
-                        out_event._coded_data = address;
-                        // Copy the timestamp --> Is it necessary to pre-process?!!!!!!
-                        out_event.stamp = qi.stamp;
-
-                        // Copy the output event into the output queue
-                        out_queue.push_back(out_event);   
-                    } else {
-                        // Otherwise
-                        yWarning() << "Not recognized event detected...";
-                        address = -1;
-                    }
-                } else {
-                    if(qi.auditory_model == 1){
-                        if(qi.xso_type == 0){
-                            // Copy the neurond ID
-                            out_event._coded_data = qi.neuron_id;
-                            // Copy the timestamp --> Is it necessary to pre-process?!!!!!!
-                            out_event.stamp = qi.stamp;
-                            // Copy the output event into the output queue
-                            out_queue.push_back(out_event); 
-                        }
-                    }
-                }
+            histogram_mutex.unlock();
 
-                // Sum up the event to the MSO matrix values only if the incoming
-                // event is from MSO
-                if(qi.auditory_model == 1){
-                    if(qi.xso_type == 0){
-                        // Get the freq channel id
-                        int ch = qi.freq_chnn;
-                        // Substract the MSO start channel to start the IDs in zero
-                        ch = ch - cochleaHelper::mso_start_freq_channel;
-                        // Get the neuron ID
-                        int ne = qi.neuron_id;
-                        // Increment the MSO matrix values in one
-                        mso_histogram[ch][ne] = mso_histogram[ch][ne] + 1;
-                    }
-                }
-                if(qi.auditory_model == 0){
-                    nas_histogram[address] = nas_histogram[address] + 1;
-                }
+            // If debug flag enabled, print it out
+            if (is_debug_flag == true) {
+                for(auto &qi : *q)
+                    yDebug() << "Event received and decoded address: " << cochleaHelper::getAddress(qi._cochleaei);
             }
 
+            if(with_spinnaker && n_invalid)
+                yWarning() << n_invalid << "not recognized events detected...";
+
             // After processing the packet output the results
             // (only if there is something to output
-            if(out_queue.size()) {
+            if(n_out) {
+                out_queue.resize(n_out);
                 output_port.write(out_queue, yarpstamp);
-                out_queue.clear();
             }
         }
     }
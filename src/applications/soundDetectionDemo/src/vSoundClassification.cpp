@@ -75,6 +75,10 @@ public:
         // Set the module name used to name ports
         setName((rf.check("name", Value("/vSoundClassification")).asString()).c_str());
 
+        //publish the latency histograms of the input ports
+        if(rf.check("stats") && rf.check("stats", Value(true)).asBool())
+            vTrace::setStatsPort(getName("/stats:o"));
+
         // Open input port
         yInfo() << "Opening input port...";
         if(!input_port.open(getName() + "/AE:i")) {
@@ -20,6 +20,7 @@
 
 #include <event-driven/all.h>
 #include <math.h>
+#include <vector>
 
 class gaborfilter {
 
@@ -52,6 +53,8 @@ public:
     void setCenter(int cx, int cy);
     void setParameters(double sigma, double stdsperlambda, double orientation, double disppx);
     void setComplex(bool complex = true) { complexgabor = complex; }
+    bool isComplex() const { return complexgabor; }
+    void kernel(int x, int y, int channel, double &even, double &odd) const;
     void process(ev::event<ev::AE> evt, double gain = 1.0);
     void process(ev::vQueue &q, double gain = 1.0);
     double getResponse();
@@ -59,6 +62,40 @@ public:
 
 
 
+};
+
+//a bank of gabor filters with the even and odd kernel of every filter
+//precomputed for each pixel offset (and camera) in a window around the
+//centre. The values for one offset are contiguous so an event updates all
+//filters in a single pass.
+class gaborbank {
+
+private:
+
+    int cx;
+    int cy;
+    int halfsize;
+    int side;
+    int nfilters;
+    bool complexgabor;
+
+    //[channel][y][x] -> nfilters even values followed by nfilters odd values
+    std::vector<double> lut;
+    std::vector<double> evenresponse;
+    std::vector<double> oddresponse;
+
+public:
+
+    gaborbank();
+
+    void initialise(const std::vector<gaborfilter> &filters, int cx, int cy,
+                    int halfsize);
+    void process(int x, int y, int channel, double gain = 1.0);
+    void process(ev::vQueue &q, double gain = 1.0);
+    double getResponse(int i);
+    int size() { return nfilters; }
+    void resetResponse();
+
 };
 
 
@@ -49,6 +49,7 @@ private:
 
     //filters
     std::vector<gaborfilter> filters;
+    gaborbank filterbank;
     std::vector<double> filterweights;
 
     //gaze controller
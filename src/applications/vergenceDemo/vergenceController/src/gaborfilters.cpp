@@ -76,8 +76,26 @@ void gaborfilter::resetResponse() {
 
 void gaborfilter::process(ev::event<ev::AE> evt, double gain)
 {
-    int dx = evt->x - cx;
-    int dy = evt->y - cy;
+    double even, odd;
+    kernel(evt->x, evt->y, evt->getChannel(), even, odd);
+
+    if(complexgabor)
+    {
+        evenresponse += gain * even;
+        oddresponse  += gain * odd;
+        //response = evenresponse * evenresponse + oddresponse * oddresponse;
+    }
+    else
+    {
+        response += gain * even;
+    }
+}
+
+void gaborfilter::kernel(int x, int y, int channel, double &even,
+                         double &odd) const
+{
+    int dx = x - cx;
+    int dy = y - cy;
 
     double dx_theta =  dx * costheta + dy * sintheta;
     double dy_theta = -dx * sintheta + dy * costheta;
@@ -91,7 +109,7 @@ void gaborfilter::process(ev::event<ev::AE> evt, double gain)
     //add in the even component also
     double cosComponent = 0.0;
     double sinComponent = 0.0;
-    if(evt->getChannel())
+    if(channel)
     {
         cosComponent = cos( coeff * (dx_theta + disppx ) );
         sinComponent = sin( coeff * (dx_theta + disppx ) );
@@ -102,25 +120,97 @@ void gaborfilter::process(ev::event<ev::AE> evt, double gain)
         sinComponent = sin( (coeff * dx_theta ) );
     }
 
+    even = gaussianComponent * cosComponent;
+    odd = gaussianComponent * sinComponent;
+}
 
-    if(complexgabor)
-    {
-        evenresponse += gain * gaussianComponent * cosComponent;
-        oddresponse  += gain * gaussianComponent * sinComponent;
-        //response = evenresponse * evenresponse + oddresponse * oddresponse;
+void gaborfilter::process(ev::vQueue &q, double gain)
+{
+    for(ev::vQueue::iterator wi = q.begin(); wi != q.end(); wi++) {
+        auto aep = is_event<AE>(*wi);
+        process(aep, gain);
     }
-    else
-    {
-        response += gain * gaussianComponent * cosComponent;
+}
+
+gaborbank::gaborbank()
+{
+    cx = 0;
+    cy = 0;
+    halfsize = 0;
+    side = 1;
+    nfilters = 0;
+    complexgabor = true;
+}
+
+void gaborbank::initialise(const std::vector<gaborfilter> &filters, int cx,
+                           int cy, int halfsize)
+{
+    this->cx = cx;
+    this->cy = cy;
+    this->halfsize = halfsize;
+    side = 2 * halfsize + 1;
+    nfilters = filters.size();
+    complexgabor = nfilters ? filters.front().isComplex() : true;
+
+    evenresponse.assign(nfilters, 0.0);
+    oddresponse.assign(nfilters, 0.0);
+
+    //the same computation as gaborfilter::process, done once per offset
+    lut.resize(2 * side * side * 2 * nfilters);
+    for(int c = 0; c < 2; c++) {
+        for(int y = 0; y < side; y++) {
+            for(int x = 0; x < side; x++) {
+                double *block = lut.data() +
+                        ((c * side + y) * side + x) * 2 * nfilters;
+                for(int f = 0; f < nfilters; f++)
+                    filters[f].kernel(cx - halfsize + x, cy - halfsize + y, c,
+                                      block[f], block[nfilters + f]);
+            }
+        }
     }
 }
 
-void gaborfilter::process(ev::vQueue &q, double gain)
+void gaborbank::process(int x, int y, int channel, double gain)
+{
+    int dx = x - cx + halfsize;
+    int dy = y - cy + halfsize;
+    if(dx < 0 || dx >= side || dy < 0 || dy >= side)
+        return;
+
+    const double *block = lut.data() +
+            (((channel ? 1 : 0) * side + dy) * side + dx) * 2 * nfilters;
+    const double *evenblock = block;
+    const double *oddblock = block + nfilters;
+    double *even = evenresponse.data();
+    double *odd = oddresponse.data();
+
+    for(int f = 0; f < nfilters; f++)
+        even[f] += gain * evenblock[f];
+    if(complexgabor)
+        for(int f = 0; f < nfilters; f++)
+            odd[f] += gain * oddblock[f];
+}
+
+void gaborbank::process(ev::vQueue &q, double gain)
 {
     for(ev::vQueue::iterator wi = q.begin(); wi != q.end(); wi++) {
         auto aep = is_event<AE>(*wi);
-        process(aep, gain);
+        process(aep->x, aep->y, aep->getChannel(), gain);
     }
 }
 
+double gaborbank::getResponse(int i)
+{
+    if(!complexgabor)
+        return evenresponse[i];
+    else
+        return sqrt(pow(evenresponse[i], 2.0) + pow(oddresponse[i], 2.0));
+}
+
+void gaborbank::resetResponse()
+{
+    evenresponse.assign(nfilters, 0.0);
+    oddresponse.assign(nfilters, 0.0);
+}
+
 //empty line to make gcc happy
@@ -175,6 +175,9 @@ vVergenceManager::vVergenceManager(int width, int height, int nEvents, int numbe
         std::cout << std::endl << std::endl;
     }
 
+    //precompute the kernels of all filters over the processed window
+    filterbank.initialise(filters, width/2, height/2, winsize/2);
+
     //create the surface representations
     fifoLeft = new ev::fixedSurface(nEvents, width, height);
     fifoRight = new ev::fixedSurface(nEvents, width, height);
@@ -330,10 +333,8 @@ void vVergenceManager::onRead(ev::vBottle &bot)
         countA++;
         countR += removed.size();
 
-        for(unsigned int i = 0; i < filters.size(); i++) {
-            filters[i].process(aep);
-            filters[i].process(removed, -1.0);
-        }
+        filterbank.process(aep->x, aep->y, aep->getChannel());
+        filterbank.process(removed, -1.0);
 
         //add events that need to be added to the out bottle
         //outBottle.addEvent(**qi);
@@ -344,10 +345,10 @@ void vVergenceManager::onRead(ev::vBottle &bot)
     double totale = 0.0;
     for(int i = 0; i < numberOri; i++) {
         for(int j = 0; j < numberPhases; j++) {
-            if(filters[j + i * numberPhases].getResponse() > threshold)
+            if(filterbank.getResponse(j + i * numberPhases) > threshold)
             {
-                respsum += filterweights[j + i * numberPhases] * filters[j + i * numberPhases].getResponse();
-                totale  += filters[j + i * numberPhases].getResponse();
+                respsum += filterweights[j + i * numberPhases] * filterbank.getResponse(j + i * numberPhases);
+                totale  += filterbank.getResponse(j + i * numberPhases);
             }
         }
     }
@@ -401,8 +402,8 @@ void vVergenceManager::onRead(ev::vBottle &bot)
     scopefiltersbot.clear();
     for(int i = 0; i < numberOri; i++) {
         for(int j = 0; j < numberPhases; j++) {
-            if(filters[j + i * numberPhases].getResponse() > 0)
-                scopefiltersbot.addDouble(filters[j + i * numberPhases].getResponse());
+            if(filterbank.getResponse(j + i * numberPhases) > 0)
+                scopefiltersbot.addDouble(filterbank.getResponse(j + i * numberPhases));
             else
                 scopefiltersbot.addDouble(0.0);
         }
@@ -0,0 +1,134 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \defgroup Benchmarks Benchmarks
+/// \defgroup vBenchmarkSuite vBenchmarkSuite
+/// \ingroup Benchmarks
+/// \brief offline micro-benchmarks of the codecs, surfaces, filters and
+/// algorithms, reported in events/s and ns/event
+
+#ifndef __VBENCHMARK__
+#define __VBENCHMARK__
+
+#include <yarp/os/all.h>
+#include <event-driven/all.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// \brief the events all cases are run on: a synthetic stream or a recording
+/// made by binaryDumper, decoded once before any timing
+struct benchStream
+{
+    std::string source;
+    std::vector<ev::AE> events;
+    unsigned int width;
+    unsigned int height;
+    unsigned int packet; /// events per packet for the packet based cases
+
+    /// \brief the stream as a vQueue, for the classes that use event<>
+    const ev::vQueue &queue();
+
+    /// \brief the stream cut into packets of at most packet events
+    const std::vector< std::vector<ev::AE> > &packets();
+
+    /// \brief the number of packets needed to cover the first n events
+    size_t packetsFor(size_t n) const
+    {
+        return (std::min(n, events.size()) + packet - 1) / packet;
+    }
+
+private:
+
+    ev::vQueue q;
+    std::vector< std::vector<ev::AE> > p;
+};
+
+/// \brief a single benchmark. pass() processes (at least) the first n events
+/// of the stream and returns the number of events it processed. reset()
+/// restores the initial state and is called, untimed, before each pass.
+struct benchCase
+{
+    std::string name;
+    std::function<void()> reset;
+    std::function<size_t(size_t n)> pass;
+};
+
+/// \brief the timing of one case. Rates are computed from the median pass
+struct benchResult
+{
+    std::string name;
+    size_t events;
+    int passes;
+    double ns_per_event;
+    double ns_per_event_min;
+    double ns_per_event_max;
+    double events_per_second() const
+    {
+        return ns_per_event > 0 ? 1e9 / ns_per_event : 0.0;
+    }
+};
+
+class vBenchmark
+{
+private:
+
+    std::vector<benchCase> cases;
+    std::vector<benchResult> results;
+
+    double min_time;
+    int min_passes;
+    size_t n_events;
+
+public:
+
+    vBenchmark(double min_time, int min_passes, size_t n_events) :
+        min_time(min_time), min_passes(min_passes), n_events(n_events) {}
+
+    void add(const std::string &name, std::function<size_t(size_t n)> pass,
+             std::function<void()> reset = std::function<void()>());
+
+    const std::vector<benchCase> &list() const { return cases; }
+
+    /// \brief run every case whose name contains filter (all if empty)
+    void run(const std::string &filter);
+
+    const std::vector<benchResult> &getResults() const { return results; }
+
+    /// \brief write the results and the stream they were measured on
+    bool writeJSON(const std::string &file, const benchStream &stream) const;
+};
+
+/// \brief store a result so that the work producing it is not optimised away
+void keep(size_t value);
+
+//the cases of each part of the tree, added only if it is built
+void addCodecCases(vBenchmark &bench, benchStream &stream);
+void addFilterCases(vBenchmark &bench, benchStream &stream);
+void addClusterCases(vBenchmark &bench, benchStream &stream);
+#ifdef VLIB_DEPRECATED
+void addSurfaceCases(vBenchmark &bench, benchStream &stream);
+void addAlgorithmCases(vBenchmark &bench, benchStream &stream);
+#endif
+#ifdef OpenCV_FOUND
+void addDrawCases(vBenchmark &bench, benchStream &stream);
+#endif
+
+#endif
+//empty line to make gcc happy
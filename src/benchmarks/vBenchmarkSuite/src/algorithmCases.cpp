@@ -0,0 +1,183 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include "vFlow.h"
+#include "vHarrisCallback.h"
+#include "vCircleObserver.h"
+#include <memory>
+
+using namespace ev;
+using std::vector;
+
+// the per-event computation of vFlow, vCorner and vCircle, with the default
+// parameters of each module. The kernels that need a populated surface
+// (computeGrads, detectcorner) are timed on neighbourhoods collected from the
+// stream beforehand, and report the time per neighbourhood.
+
+//at most this many neighbourhoods are stored, and reused cyclically
+static const size_t max_patches = 20000;
+
+class flowBench : public vFlowManager
+{
+public:
+    flowBench(int height, int width) : vFlowManager(height, width, 3, 5) {}
+    using vFlowManager::compute;
+    using vFlowManager::computeGrads;
+};
+
+class harrisBench : public vHarrisCallback
+{
+public:
+    harrisBench(int height, int width) :
+        vHarrisCallback(height, width, 0.1, 36, 5, 5, 1.0, 8.0) {}
+    using vHarrisCallback::detectcorner;
+};
+
+struct patch {
+    vQueue q;
+    event<AE> centre;
+};
+
+static void addFlowCases(vBenchmark &bench, benchStream &stream)
+{
+    auto flow = std::make_shared<flowBench>(stream.height, stream.width);
+
+    //one surface per camera and polarity, as vFlowManager::onRead
+    auto surfaces = std::make_shared< vector<temporalSurface> >();
+    auto reset = [&stream, surfaces]() {
+        surfaces->assign(4, temporalSurface(stream.width, stream.height));
+    };
+
+    //the planes that vFlowManager::compute fits (filterSize 3)
+    auto planes = std::make_shared< vector<patch> >();
+    reset();
+    const vQueue &q = stream.queue();
+    for(size_t i = 0; i < q.size() && planes->size() < max_patches; i++) {
+        const AE &v = stream.events[i];
+        temporalSurface &s = (*surfaces)[2 * v.channel + v.polarity];
+        s.fastAddEvent(q[i]);
+        vQueue subsurf = s.getSurf(v.x, v.y, 1);
+        if(subsurf.size() >= 9)
+            planes->push_back({subsurf, is_event<AE>(q[i])});
+    }
+
+    bench.add("vFlowManager/computeGrads", [flow, planes](size_t n) {
+        if(planes->empty()) return (size_t)0;
+        double dtdx, dtdy;
+        size_t inliers = 0;
+        for(size_t i = 0; i < n; i++) {
+            const patch &p = (*planes)[i % planes->size()];
+            inliers += flow->computeGrads(p.q, p.centre, dtdy, dtdx);
+        }
+        keep(inliers);
+        return n;
+    });
+
+    bench.add("vFlowManager/compute", [&stream, flow, surfaces](size_t n) {
+        const vQueue &q = stream.queue();
+        n = std::min(n, q.size());
+        size_t flows = 0;
+        double vx, vy;
+        for(size_t i = 0; i < n; i++) {
+            const AE &v = stream.events[i];
+            temporalSurface &s = (*surfaces)[2 * v.channel + v.polarity];
+            s.fastAddEvent(q[i]);
+            flows += flow->compute(&s, vx, vy);
+        }
+        keep(flows);
+        return n;
+    }, reset);
+}
+
+static void addHarrisCases(vBenchmark &bench, benchStream &stream)
+{
+    auto harris = std::make_shared<harrisBench>(stream.height, stream.width);
+
+    //the patches vHarrisCallback::onRead collects (qsize 36, spatial 5)
+    auto patches = std::make_shared< vector<patch> >();
+    vector<temporalSurface> surfaces(2, temporalSurface(stream.width,
+                                                        stream.height,
+                                                        0.1 * vtsHelper::vtsscaler));
+    const vQueue &q = stream.queue();
+    for(size_t i = 0; i < q.size() && patches->size() < max_patches; i++) {
+        const AE &v = stream.events[i];
+        surfaces[v.channel].fastAddEvent(q[i]);
+        patches->push_back({surfaces[v.channel].getSurf_Clim(36, v.x, v.y, 5),
+                            is_event<AE>(q[i])});
+    }
+
+    bench.add("vHarrisCallback/detectcorner", [harris, patches](size_t n) {
+        if(patches->empty()) return (size_t)0;
+        size_t corners = 0;
+        for(size_t i = 0; i < n; i++) {
+            const patch &p = (*patches)[i % patches->size()];
+            corners += harris->detectcorner(p.q, p.centre->x, p.centre->y);
+        }
+        keep(corners);
+        return n;
+    });
+}
+
+static void addCircleCases(vBenchmark &bench, benchStream &stream)
+{
+    //each packet adds its events and removes those that leave a fifo of 1000
+    //events (qType fixed), radii 10 to 35 on a single thread
+    const size_t fifo = 1000;
+    auto updates = std::make_shared< vector< std::pair<vQueue, vector<int> > > >();
+    const vQueue &q = stream.queue();
+    for(size_t i = 0; i < q.size(); i += stream.packet) {
+        size_t end = std::min(i + stream.packet, q.size());
+        updates->emplace_back();
+        auto &u = updates->back();
+        for(size_t j = i; j < end; j++) {
+            u.first.push_back(q[j]);
+            u.second.push_back(1);
+            if(j >= fifo) {
+                u.first.push_back(q[j - fifo]);
+                u.second.push_back(-1);
+            }
+        }
+    }
+
+    auto volume = std::make_shared< std::unique_ptr<vHoughVolume> >();
+    auto reset = [&stream, volume]() {
+        volume->reset();
+        volume->reset(new vHoughVolume(10, 35, false, 1, stream.height,
+                                       stream.width));
+    };
+
+    bench.add("vHoughVolume/process", [&stream, volume, updates](size_t n) {
+        size_t count = 0;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            auto &u = (*updates)[i];
+            (*volume)->process(u.first, u.second);
+            count += stream.packets()[i].size();
+        }
+        int x, y, r;
+        keep((*volume)->getObs(x, y, r) > 0);
+        return count;
+    }, reset);
+}
+
+void addAlgorithmCases(vBenchmark &bench, benchStream &stream)
+{
+    addFlowCases(bench, stream);
+    addHarrisCases(bench, stream);
+    addCircleCases(bench, stream);
+}
@@ -0,0 +1,54 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include "trackerPool.h"
+#include <memory>
+
+using namespace ev;
+
+// the vCluster tracker update with the vCluster default parameters
+
+void addClusterCases(vBenchmark &bench, benchStream &stream)
+{
+    auto pools = std::make_shared< std::vector<TrackerPool> >();
+    auto clEvts = std::make_shared< std::vector<GaussianAE> >();
+
+    auto reset = [pools]() {
+        pools->assign(2, TrackerPool());
+        for(auto &pool : *pools) {
+            pool.setComparisonParams(10);
+            pool.setDecayParams(10000, 20, 10, 5, 2, 50);
+            pool.setInitialParams(5, 5, 0, 0.1, 0.01, false);
+            pool.setClusterLimit(-1);
+        }
+    };
+
+    bench.add("TrackerPool/update", [&stream, pools, clEvts](size_t n) {
+        size_t clusters = 0;
+        n = std::min(n, stream.events.size());
+        for(size_t i = 0; i < n; i++) {
+            const AE &v = stream.events[i];
+            (*pools)[v.channel].update(v, *clEvts);
+            clusters += clEvts->size();
+            clEvts->clear();
+        }
+        keep(clusters);
+        return n;
+    }, reset);
+}
@@ -0,0 +1,120 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include <memory>
+
+using namespace ev;
+using std::vector;
+
+// encoding and decoding of packets as done by vWritePort and vReadPort
+
+void addCodecCases(vBenchmark &bench, benchStream &stream)
+{
+    const unsigned int row = packetSize(AE::tag);
+
+    //the packets encoded once, for the decoding cases
+    auto encoded = std::make_shared< vector< vector<int32_t> > >();
+    for(auto &p : stream.packets()) {
+        vPortableInterface pi;
+        pi.setInternalData(p);
+        const int32_t *data = (const int32_t *)pi.getDataBlock();
+        encoded->emplace_back(data, data + pi.getDataLength() / sizeof(int32_t));
+    }
+
+    auto queues = std::make_shared< vector<vQueue> >();
+    const vQueue &q = stream.queue();
+    for(size_t i = 0; i < q.size(); i += stream.packet)
+        queues->emplace_back(q.begin() + i,
+                             q.begin() + std::min(i + stream.packet, q.size()));
+
+    auto portable = std::make_shared<vPortableInterface>();
+
+    bench.add("vPortableInterface/encode<AE>", [&stream, portable](size_t n) {
+        size_t count = 0;
+        auto &packets = stream.packets();
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            portable->setInternalData(packets[i]);
+            count += packets[i].size();
+        }
+        return count;
+    });
+
+    bench.add("vPortableInterface/encode<vQueue>", [&stream, queues, portable](size_t n) {
+        size_t count = 0;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            portable->setInternalData((*queues)[i]);
+            count += (*queues)[i].size();
+        }
+        return count;
+    });
+
+    auto decoded = std::make_shared< vector<AE> >();
+    bench.add("vPortableInterface/decode<AE>", [&stream, encoded, portable, decoded, row](size_t n) {
+        size_t count = 0;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            auto &data = (*encoded)[i];
+            portable->setReadData(AE::tag, data.data(), data.size());
+            portable->decodePacket(*decoded);
+            count += data.size() / row;
+        }
+        return count;
+    });
+
+    auto decoded_q = std::make_shared<vQueue>();
+    bench.add("vPortableInterface/decode<vQueue>", [&stream, encoded, portable, decoded_q, row](size_t n) {
+        size_t count = 0;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            auto &data = (*encoded)[i];
+            decoded_q->clear();
+            portable->setReadData(AE::tag, data.data(), data.size());
+            portable->decodePacket(*decoded_q);
+            count += data.size() / row;
+        }
+        return count;
+    });
+
+    //the compressed packet format (vWritePort::setCompression)
+    auto compressor = std::make_shared<vPacketCompressor>();
+    auto compressed = std::make_shared< vector< vector<int32_t> > >(encoded->size());
+    for(size_t i = 0; i < encoded->size(); i++)
+        compressor->compress((*encoded)[i].data(), (*encoded)[i].size(), row,
+                             (*compressed)[i]);
+
+    bench.add("vPacketCompressor/compress", [&stream, encoded, compressor, row](size_t n) {
+        size_t count = 0;
+        vector<int32_t> out;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            auto &data = (*encoded)[i];
+            compressor->compress(data.data(), data.size(), row, out);
+            count += data.size() / row;
+        }
+        return count;
+    });
+
+    bench.add("vPacketCompressor/decompress", [&stream, compressed, compressor, row](size_t n) {
+        size_t count = 0;
+        vector<int32_t> out;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            auto &data = (*compressed)[i];
+            compressor->decompress(data.data(), data.size(), out);
+            count += out.size() / row;
+        }
+        return count;
+    });
+}
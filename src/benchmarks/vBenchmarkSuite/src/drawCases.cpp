@@ -0,0 +1,122 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include <event-driven/vDraw.h>
+#include <event-driven/vDrawSkin.h>
+#include <map>
+#include <memory>
+
+using namespace ev;
+using std::vector;
+
+// every drawer of the library drawing each packet as vFramer draws a window.
+// The skin drawers load their taxel maps from the skinGui context: without it
+// they draw nothing and only the event loop is measured.
+
+//the stream converted to the event type a drawer needs
+static event<> convert(const AE &v, size_t i, const std::string &type)
+{
+    event<> e = createEvent(type);
+    e->stamp = v.stamp;
+
+    if(auto ae = as_event<AE>(e)) {
+        ae->_coded_data = v._coded_data;
+        if(auto fe = as_event<FlowEvent>(e)) {
+            fe->vx = (float)((int)(i % 200) - 100);
+            fe->vy = (float)((int)(i % 150) - 75);
+        }
+        if(auto le = as_event<LabelledAE>(e))
+            le->ID = i % 8;
+        if(auto ge = as_event<GaussianAE>(e)) {
+            ge->sigx = 5.0f;
+            ge->sigy = 3.0f;
+            ge->sigxy = 1.0f;
+        }
+    } else if(auto se = as_event<SkinEvent>(e)) {
+        se->polarity = v.polarity;
+        se->taxel = (v.y * 304 + v.x) % 1024;
+        if(auto ss = as_event<SkinSample>(e))
+            ss->value = (v.x * 211) & 0xFFFF;
+    } else if(auto ie = as_event<IMUevent>(e)) {
+        ie->sensor = i % 10;
+        ie->value = (int)(v.x * 100) - 15000;
+    } else if(auto ce = as_event<CochleaEvent>(e)) {
+        ce->polarity = v.polarity;
+        ce->channel = v.channel;
+        ce->freq_chnn = v.x % 128;
+        ce->neuron_id = v.y % 128;
+    }
+    return e;
+}
+
+//the converted packets are shared by the drawers of the same event type and
+//limited in number (reused cyclically) to bound the memory they take
+static const size_t max_packets = 50;
+typedef std::map< std::string, std::shared_ptr< vector<vQueue> > > packetCache;
+
+static void addDrawCase(vBenchmark &bench, benchStream &stream,
+                        packetCache &cache, vDraw *drawer)
+{
+    std::shared_ptr<vDraw> d(drawer);
+    d->setRetinaLimits(stream.width, stream.height);
+    d->initialise();
+
+    const std::string type = d->getEventType();
+    auto &packets = cache[type];
+    if(!packets) {
+        packets = std::make_shared< vector<vQueue> >();
+        for(size_t i = 0; i < stream.events.size() &&
+            packets->size() < max_packets; i += stream.packet) {
+            packets->emplace_back();
+            for(size_t j = i; j < std::min(i + stream.packet, stream.events.size()); j++)
+                packets->back().push_back(convert(stream.events[j], j, type));
+        }
+    }
+
+    auto canvas = std::make_shared<cv::Mat>();
+    bench.add("vDraw/" + d->getDrawType(), [&stream, d, packets, canvas](size_t n) {
+        size_t count = 0;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            const vQueue &q = (*packets)[i % packets->size()];
+            d->resetImage(*canvas);
+            d->draw(*canvas, q, -1);
+            count += q.size();
+        }
+        return count;
+    });
+}
+
+void addDrawCases(vBenchmark &bench, benchStream &stream)
+{
+    packetCache cache;
+    addDrawCase(bench, stream, cache, new addressDraw());
+    addDrawCase(bench, stream, cache, new isoDraw());
+    addDrawCase(bench, stream, cache, new rasterDraw());
+    addDrawCase(bench, stream, cache, new flowDraw());
+    addDrawCase(bench, stream, cache, new interestDraw());
+    addDrawCase(bench, stream, cache, new isoInterestDraw());
+    addDrawCase(bench, stream, cache, new clusterDraw());
+    addDrawCase(bench, stream, cache, new imuDraw());
+    addDrawCase(bench, stream, cache, new cochleaDraw());
+    addDrawCase(bench, stream, cache, new skinDraw());
+    addDrawCase(bench, stream, cache, new skinsampleDraw());
+    addDrawCase(bench, stream, cache, new taxelsampleDraw());
+    addDrawCase(bench, stream, cache, new taxeleventDraw());
+    addDrawCase(bench, stream, cache, new isoDrawSkin());
+}
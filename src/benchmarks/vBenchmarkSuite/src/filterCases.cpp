@@ -0,0 +1,59 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include <memory>
+
+using namespace ev;
+
+// vNoiseFilter with the vPreProcess default parameters
+
+static void addNoiseCase(vBenchmark &bench, benchStream &stream,
+                         const std::string &name, bool spatial, bool temporal)
+{
+    auto filters = std::make_shared< std::vector<vNoiseFilter> >();
+
+    auto reset = [&stream, filters, spatial, temporal]() {
+        filters->assign(2, vNoiseFilter());
+        for(auto &f : *filters) {
+            f.initialise(stream.width, stream.height);
+            if(spatial)
+                f.use_spatial_filter(0.05 * vtsHelper::vtsscaler, 1);
+            if(temporal)
+                f.use_temporal_filter(0.1 * vtsHelper::vtsscaler);
+        }
+    };
+
+    bench.add(name, [&stream, filters](size_t n) {
+        size_t passed = 0;
+        n = std::min(n, stream.events.size());
+        for(size_t i = 0; i < n; i++) {
+            const AE &v = stream.events[i];
+            passed += (*filters)[v.channel].check(v.x, v.y, v.polarity, v.stamp);
+        }
+        keep(passed);
+        return n;
+    }, reset);
+}
+
+void addFilterCases(vBenchmark &bench, benchStream &stream)
+{
+    addNoiseCase(bench, stream, "vNoiseFilter/check_temporal", false, true);
+    addNoiseCase(bench, stream, "vNoiseFilter/check_spatial", true, false);
+    addNoiseCase(bench, stream, "vNoiseFilter/check_both", true, true);
+}
@@ -0,0 +1,164 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include <fstream>
+#include <random>
+
+using namespace ev;
+using namespace yarp::os;
+
+//a recording made by binaryDumper (binaryevents.log): raw [stamp, address]
+static bool load_binary(const std::string &file, size_t max_events,
+                        benchStream &stream)
+{
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    if(!in.is_open())
+        return false;
+    size_t bytes = in.tellg();
+    bytes -= bytes % (2 * sizeof(int32_t));
+    bytes = std::min(bytes, 2 * sizeof(int32_t) * max_events);
+    std::vector<int32_t> data(bytes / sizeof(int32_t));
+    in.seekg(0);
+    in.read((char *)data.data(), bytes);
+    if(!in)
+        return false;
+
+    //decoded as a reading port would
+    vPortableInterface decoder;
+    decoder.setReadData(AE::tag, data.data(), data.size());
+    return decoder.decodePacket(stream.events);
+}
+
+//stereo bars sweeping across the sensor over uniform background noise, at a
+//constant event rate
+static void make_synthetic(size_t n_events, double rate, benchStream &stream)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    const int w = stream.width, h = stream.height;
+    const double period = vtsHelper::vtsscaler / rate;
+    const double sweep = 0.5 * vtsHelper::vtsscaler; //ticks to cross the sensor
+
+    stream.events.resize(n_events);
+    for(size_t i = 0; i < n_events; i++) {
+        double t = i * period;
+        AE &v = stream.events[i];
+        v.stamp = (unsigned int)t & vtsHelper::max_stamp;
+        v._coded_data = 0;
+        v.channel = rng() & 1;
+        v.polarity = rng() & 1;
+        if(uniform(rng) < 0.1) {
+            v.x = rng() % w;
+            v.y = rng() % h;
+        } else {
+            int bar = (int)(w * t / sweep) % w;
+            v.x = std::max(0, std::min(w - 1, bar + jitter(rng) + 10 * (int)v.channel));
+            v.y = rng() % h;
+        }
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    ResourceFinder rf;
+    rf.configure(argc, argv);
+
+    if(rf.check("h") || rf.check("help")) {
+        yInfo() << "vBenchmarkSuite: offline micro-benchmarks of the event"
+                   " codecs, surfaces, filters and algorithms";
+        yInfo() << "--file <path>: a binaryevents.log recorded by binaryDumper"
+                   " (default: a synthetic stereo stream)";
+        yInfo() << "--events <int>: events processed by each pass";
+        yInfo() << "--rate <double>: event rate of the synthetic stream (ev/s)";
+        yInfo() << "--width <int>, --height <int>: sensor size (default: the"
+                   " extent of the recording, or 304x240)";
+        yInfo() << "--packet <int>: events per packet";
+        yInfo() << "--time <double>: minimum time spent timing each case (s)";
+        yInfo() << "--passes <int>: minimum number of timed passes of each case";
+        yInfo() << "--filter <string>: only run the cases containing this";
+        yInfo() << "--list: print the cases and exit";
+        yInfo() << "--json <path>: also write the results as JSON";
+        return 0;
+    }
+
+    size_t n_events = rf.check("events", Value(200000)).asInt();
+    std::string file = rf.check("file", Value("")).asString();
+
+    benchStream stream;
+    stream.packet = std::max(1, rf.check("packet", Value(1000)).asInt());
+    stream.width = rf.check("width", Value(304)).asInt();
+    stream.height = rf.check("height", Value(240)).asInt();
+    if(file.size()) {
+        stream.source = file;
+        if(!load_binary(file, n_events, stream)) {
+            yError() << "Could not read" << file;
+            return -1;
+        }
+        if(!rf.check("width") || !rf.check("height")) {
+            stream.width = stream.height = 1;
+            for(auto &v : stream.events) {
+                stream.width = std::max(stream.width, (unsigned int)v.x + 1);
+                stream.height = std::max(stream.height, (unsigned int)v.y + 1);
+            }
+        }
+    } else {
+        stream.source = "synthetic";
+        make_synthetic(n_events, rf.check("rate", Value(1e6)).asDouble(),
+                       stream);
+    }
+    if(stream.events.empty()) {
+        yError() << "No events to process";
+        return -1;
+    }
+    n_events = stream.events.size();
+
+    vBenchmark bench(rf.check("time", Value(1.0)).asDouble(),
+                     rf.check("passes", Value(3)).asInt(), n_events);
+    addCodecCases(bench, stream);
+    addFilterCases(bench, stream);
+    addClusterCases(bench, stream);
+#ifdef VLIB_DEPRECATED
+    addSurfaceCases(bench, stream);
+    addAlgorithmCases(bench, stream);
+#endif
+#ifdef OpenCV_FOUND
+    addDrawCases(bench, stream);
+#endif
+
+    if(rf.check("list")) {
+        for(auto &c : bench.list())
+            yInfo() << c.name;
+        return 0;
+    }
+
+    yInfo() << n_events << "events from" << stream.source << "on a"
+            << stream.width << "x" << stream.height << "sensor, packets of"
+            << stream.packet;
+    bench.run(rf.check("filter", Value("")).asString());
+
+    std::string json = rf.check("json", Value("")).asString();
+    if(json.size() && !bench.writeJSON(json, stream)) {
+        yError() << "Could not write" << json;
+        return -1;
+    }
+
+    return 0;
+}
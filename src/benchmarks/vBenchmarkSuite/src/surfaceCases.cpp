@@ -0,0 +1,118 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include <event-driven/deprecated.h>
+#include <memory>
+
+using namespace ev;
+using std::vector;
+
+// the vBottle format and the temporalSurface, used by the older modules
+
+void addSurfaceCases(vBenchmark &bench, benchStream &stream)
+{
+    const vQueue &q = stream.queue();
+
+    //vBottle: filling and reading back the packets
+    auto bottles = std::make_shared< vector<vBottle> >();
+    for(size_t i = 0; i < q.size(); i += stream.packet) {
+        bottles->emplace_back();
+        for(size_t j = i; j < std::min(i + stream.packet, q.size()); j++)
+            bottles->back().addEvent(q[j]);
+    }
+
+    bench.add("vBottle/addEvent", [&stream](size_t n) {
+        const vQueue &q = stream.queue();
+        n = std::min(n, q.size());
+        vBottle b;
+        for(size_t i = 0; i < n; i++) {
+            if(i % stream.packet == 0)
+                b.clear();
+            b.addEvent(q[i]);
+        }
+        keep(b.size());
+        return n;
+    });
+
+    bench.add("vBottle/addtoendof<AE>", [&stream, bottles](size_t n) {
+        size_t count = 0;
+        vQueue out;
+        for(size_t i = 0; i < stream.packetsFor(n); i++) {
+            out.clear();
+            (*bottles)[i].addtoendof<AE>(out);
+            count += out.size();
+        }
+        return count;
+    });
+
+    //temporalSurface: one per camera, a 0.1 s window as used by vCorner
+    auto surfaces = std::make_shared< vector<temporalSurface> >();
+    auto reset = [&stream, surfaces]() {
+        surfaces->assign(2, temporalSurface(stream.width, stream.height,
+                                            0.1 * vtsHelper::vtsscaler));
+    };
+
+    bench.add("temporalSurface/fastAddEvent", [&stream, surfaces](size_t n) {
+        const vQueue &q = stream.queue();
+        n = std::min(n, q.size());
+        for(size_t i = 0; i < n; i++)
+            (*surfaces)[stream.events[i].channel].fastAddEvent(q[i]);
+        keep((*surfaces)[0].getEventCount());
+        return n;
+    }, reset);
+
+    bench.add("temporalSurface/addEvent", [&stream, surfaces](size_t n) {
+        const vQueue &q = stream.queue();
+        n = std::min(n, q.size());
+        size_t removed = 0;
+        for(size_t i = 0; i < n; i++)
+            removed += (*surfaces)[stream.events[i].channel].addEvent(q[i]).size();
+        keep(removed);
+        return n;
+    }, reset);
+
+    //the query made by vCorner for each event (after adding it)
+    bench.add("temporalSurface/getSurf_Clim", [&stream, surfaces](size_t n) {
+        const vQueue &q = stream.queue();
+        n = std::min(n, q.size());
+        size_t found = 0;
+        for(size_t i = 0; i < n; i++) {
+            const AE &v = stream.events[i];
+            temporalSurface &s = (*surfaces)[v.channel];
+            s.fastAddEvent(q[i]);
+            found += s.getSurf_Clim(36, v.x, v.y, 5).size();
+        }
+        keep(found);
+        return n;
+    }, reset);
+
+    bench.add("temporalSurface/getSurf", [&stream, surfaces](size_t n) {
+        const vQueue &q = stream.queue();
+        n = std::min(n, q.size());
+        size_t found = 0;
+        for(size_t i = 0; i < n; i++) {
+            const AE &v = stream.events[i];
+            temporalSurface &s = (*surfaces)[v.channel];
+            s.fastAddEvent(q[i]);
+            found += s.getSurf(v.x, v.y, 2).size();
+        }
+        keep(found);
+        return n;
+    }, reset);
+}
@@ -0,0 +1,153 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vBenchmark.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+using namespace ev;
+
+static volatile size_t sink;
+
+void keep(size_t value)
+{
+    sink = value;
+}
+
+/******************************************************************************/
+//benchStream
+/******************************************************************************/
+const vQueue &benchStream::queue()
+{
+    if(q.size() != events.size()) {
+        q.clear();
+        for(auto &v : events)
+            q.push_back(std::make_shared<AE>(v));
+    }
+    return q;
+}
+
+const std::vector< std::vector<AE> > &benchStream::packets()
+{
+    if(p.empty() && events.size()) {
+        for(size_t i = 0; i < events.size(); i += packet)
+            p.emplace_back(events.begin() + i,
+                           events.begin() + std::min(i + packet, events.size()));
+    }
+    return p;
+}
+
+/******************************************************************************/
+//vBenchmark
+/******************************************************************************/
+void vBenchmark::add(const std::string &name,
+                     std::function<size_t(size_t n)> pass,
+                     std::function<void()> reset)
+{
+    cases.push_back({name, reset, pass});
+}
+
+void vBenchmark::run(const std::string &filter)
+{
+    typedef std::chrono::steady_clock clock;
+
+    for(auto &c : cases) {
+        if(filter.size() && c.name.find(filter) == std::string::npos)
+            continue;
+
+        //a short pass first so that caches and allocations are warm
+        if(c.reset) c.reset();
+        c.pass(std::max<size_t>(1, n_events / 10));
+
+        std::vector<double> ns;
+        size_t events = 0;
+        double total = 0;
+        while((total < min_time || (int)ns.size() < min_passes) &&
+              ns.size() < 1000) {
+            if(c.reset) c.reset();
+            auto t0 = clock::now();
+            events = c.pass(n_events);
+            double t = std::chrono::duration<double>(clock::now() - t0).count();
+            if(!events) break;
+            total += t;
+            ns.push_back(1e9 * t / events);
+        }
+        if(ns.empty()) {
+            yWarning() << c.name << "processed no events";
+            continue;
+        }
+
+        std::sort(ns.begin(), ns.end());
+        benchResult r;
+        r.name = c.name;
+        r.events = events;
+        r.passes = ns.size();
+        r.ns_per_event = ns[ns.size() / 2];
+        r.ns_per_event_min = ns.front();
+        r.ns_per_event_max = ns.back();
+        results.push_back(r);
+
+        yInfo("%-36s %10.3f Mev/s %12.1f ns/event (%d passes)",
+              r.name.c_str(), 1e-6 * r.events_per_second(), r.ns_per_event,
+              r.passes);
+    }
+}
+
+static std::string quoted(const std::string &s)
+{
+    std::string q = "\"";
+    for(char c : s) {
+        if(c == '"' || c == '\\') q += '\\';
+        q += c;
+    }
+    return q + "\"";
+}
+
+bool vBenchmark::writeJSON(const std::string &file,
+                           const benchStream &stream) const
+{
+    std::ofstream out(file);
+    if(!out.is_open())
+        return false;
+
+    out << std::setprecision(6);
+    out << "{\n";
+    out << "  \"suite\": \"vBenchmarkSuite\",\n";
+    out << "  \"compiler\": " << quoted(__VERSION__) << ",\n";
+    out << "  \"stream\": {\"source\": " << quoted(stream.source)
+        << ", \"events\": " << stream.events.size()
+        << ", \"width\": " << stream.width
+        << ", \"height\": " << stream.height
+        << ", \"packet\": " << stream.packet << "},\n";
+    out << "  \"results\": [";
+    for(size_t i = 0; i < results.size(); i++) {
+        const benchResult &r = results[i];
+        out << (i ? ",\n" : "\n");
+        out << "    {\"name\": " << quoted(r.name)
+            << ", \"events\": " << r.events
+            << ", \"passes\": " << r.passes
+            << ", \"events_per_second\": " << r.events_per_second()
+            << ", \"ns_per_event\": " << r.ns_per_event
+            << ", \"ns_per_event_min\": " << r.ns_per_event_min
+            << ", \"ns_per_event_max\": " << r.ns_per_event_max << "}";
+    }
+    out << "\n  ]\n}\n";
+
+    return (bool)out;
+}
@@ -0,0 +1,203 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/all.h>
+#include <event-driven/all.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+using namespace ev;
+using namespace yarp::os;
+using std::vector;
+
+// compares the compressed packet format (vPacketCompressor) with the raw
+// format sent by vPortableInterface, offline and without a yarp server.
+
+static double seconds_since(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+//a recording made by binaryDumper (binaryevents.log): raw [stamp, address]
+static bool load_binary(const std::string &file, vector<int32_t> &data)
+{
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    if(!in.is_open())
+        return false;
+    size_t bytes = in.tellg();
+    bytes -= bytes % (2 * sizeof(int32_t));
+    data.resize(bytes / sizeof(int32_t));
+    in.seekg(0);
+    in.read((char *)data.data(), bytes);
+    return (bool)in;
+}
+
+//stereo bars sweeping across a 304x240 sensor with background noise
+//packets with corrupt headers must be rejected without allocating for the
+//sizes they claim
+static bool rejects_corrupt(vPacketCompressor &decoder)
+{
+    const vector< vector<uint8_t> > corrupt = {
+        {0x10, 0x02, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F},        //row_ints 2^32-1
+        {0x10, 0x02, 0x80, 0x80, 0x04},                    //row_ints 2^16
+        {0x10, 0xFF, 0xFF, 0xFF, 0x1F, 0x02},              //raw_ints 2^26-1
+        {0x11, 0x80, 0x80, 0x80, 0x01, 0x02,
+         0xFF, 0xFF, 0xFF, 0xFF, 0x0F},                    //n_symbols 2^32-1
+        {0x11, 0x02, 0x00},                                //row_ints 0
+        {0x20, 0x02, 0x02}                                 //unknown version
+    };
+
+    vector<int32_t> restored;
+    for(auto &c : corrupt) {
+        vector<int32_t> packet((c.size() + 3) / 4, 0);
+        std::memcpy(packet.data(), c.data(), c.size());
+        if(decoder.decompress(packet.data(), packet.size(), restored))
+            return false;
+    }
+    return true;
+}
+
+static void make_synthetic(size_t n_events, vector<int32_t> &data)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    data.resize(2 * n_events);
+    unsigned int stamp = 0;
+    AE v;
+    for(size_t i = 0; i < n_events; i++) {
+        stamp += (uniform(rng) < 0.5) ? 0 : 1 + (rng() % 4);
+        v._coded_data = 0;
+        v.channel = rng() & 1;
+        v.polarity = rng() & 1;
+        if(uniform(rng) < 0.1) {
+            v.x = rng() % 304;
+            v.y = rng() % 240;
+        } else {
+            int bar = (stamp / 200) % 304;
+            v.x = std::max(0, std::min(303, bar + jitter(rng) + 10 * (int)v.channel));
+            v.y = rng() % 240;
+        }
+        data[2*i] = stamp & vtsHelper::max_stamp;
+        data[2*i + 1] = v._coded_data;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    ResourceFinder rf;
+    rf.configure(argc, argv);
+
+    if(rf.check("h") || rf.check("help")) {
+        yInfo() << "vCompressionBench: compression ratio and throughput of"
+                   " compressed event packets against the raw format";
+        yInfo() << "--file <path>: a binaryevents.log recorded by binaryDumper"
+                   " (default: a synthetic stereo stream)";
+        yInfo() << "--events <int>: size of the synthetic stream";
+        yInfo() << "--packet <int>: events per packet";
+        yInfo() << "--repeat <int>: passes over the data for timing";
+        return 0;
+    }
+
+    int packet = rf.check("packet", Value(2000)).asInt();
+    int repeat = rf.check("repeat", Value(5)).asInt();
+    std::string file = rf.check("file", Value("")).asString();
+
+    vector<int32_t> data;
+    if(file.size()) {
+        if(!load_binary(file, data)) {
+            yError() << "Could not read" << file;
+            return -1;
+        }
+    } else {
+        make_synthetic(rf.check("events", Value(5000000)).asInt(), data);
+    }
+    if(packet <= 0 || data.empty()) {
+        yError() << "Nothing to compress";
+        return -1;
+    }
+
+    const unsigned int row = packetSize(AE::tag);
+    const size_t step = row * packet;
+    const size_t n_events = data.size() / row;
+
+    vPacketCompressor encoder, decoder;
+    vector< vector<int32_t> > packets((data.size() + step - 1) / step);
+    vector<int32_t> restored, copied(step);
+    size_t compressed_bytes = 0;
+
+    //raw: the copy the raw format makes into the port buffer
+    auto t0 = std::chrono::steady_clock::now();
+    for(int r = 0; r < repeat; r++)
+        for(size_t i = 0; i < data.size(); i += step)
+            std::memcpy(copied.data(), data.data() + i,
+                        std::min(step, data.size() - i) * sizeof(int32_t));
+    double raw_time = seconds_since(t0) / repeat;
+
+    t0 = std::chrono::steady_clock::now();
+    for(int r = 0; r < repeat; r++) {
+        compressed_bytes = 0;
+        for(size_t i = 0, p = 0; i < data.size(); i += step, p++)
+            compressed_bytes += sizeof(int32_t) *
+                    encoder.compress(data.data() + i,
+                                     std::min(step, data.size() - i), row,
+                                     packets[p]);
+    }
+    double encode_time = seconds_since(t0) / repeat;
+
+    t0 = std::chrono::steady_clock::now();
+    for(int r = 0; r < repeat; r++)
+        for(size_t p = 0; p < packets.size(); p++)
+            decoder.decompress(packets[p].data(), packets[p].size(), restored);
+    double decode_time = seconds_since(t0) / repeat;
+
+    //check it was lossless
+    for(size_t i = 0, p = 0; i < data.size(); i += step, p++) {
+        if(!decoder.decompress(packets[p].data(), packets[p].size(), restored) ||
+                restored.size() != std::min(step, data.size() - i) ||
+                !std::equal(restored.begin(), restored.end(), data.begin() + i)) {
+            yError() << "Packet" << p << "was not restored correctly";
+            return -1;
+        }
+    }
+    if(!rejects_corrupt(decoder)) {
+        yError() << "A corrupt packet was accepted";
+        return -1;
+    }
+
+    double raw_bytes = data.size() * sizeof(int32_t);
+    yInfo() << n_events << "events in" << packets.size() << "packets of"
+            << packet << "events";
+    yInfo() << "compression ratio:" << raw_bytes / compressed_bytes
+            << "(" << 8.0 * compressed_bytes / n_events << "bits/event, raw"
+            << 8.0 * raw_bytes / n_events << ")";
+    yInfo() << "raw copy:" << 1e-6 * n_events / raw_time << "Mev/s"
+            << 1e-6 * raw_bytes / raw_time << "MB/s";
+    yInfo() << "compress:" << 1e-6 * n_events / encode_time << "Mev/s"
+            << 1e-6 * raw_bytes / encode_time << "MB/s";
+    yInfo() << "decompress:" << 1e-6 * n_events / decode_time << "Mev/s"
+            << 1e-6 * raw_bytes / decode_time << "MB/s";
+    yInfo() << "link needed for 1 Mev/s:" << 8.0 * raw_bytes / n_events
+            << "Mbit/s raw," << 8.0 * compressed_bytes / n_events
+            << "Mbit/s compressed";
+
+    return 0;
+}
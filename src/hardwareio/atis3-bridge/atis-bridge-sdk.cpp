@@ -11,8 +11,11 @@
 
 #include <yarp/os/all.h>
 #include <event-driven/all.h>
+#include <event-driven/vPacketiser.h>
 #include <opencv2/opencv.hpp>
 #include <yarp/cv/Cv.h>
+#include <atomic>
+#include <cstdint>
 
 using namespace ev;
 using namespace yarp::os;
@@ -23,20 +26,36 @@ private:
 
     Stamp yarpstamp;
     vWritePort output_port;
+    Port rpc_port;
     Stamp graystamp;
     yarp::os::BufferedPort< yarp::sig::FlexImage > grayscale_port;
     Camera cam; // create the camera
     
     int counter_packets{0};
     int counter_events{0};
+    std::atomic<int> counter_dropped{0};
     static constexpr double period{1.0};
 
-    std::mutex m;
-    vector< vector<int32_t> > buffer;
-    int buffer_size{0};
-    int buffer_used{0};
-    int b_sel{0};
-    static constexpr void switch_buffer(int &buf_i) {buf_i = (buf_i + 1) % 2;};
+    //ring of fixed size chunks filled by the camera callback and drained by
+    //the sender thread. the open chunk (its sequence number and fill) is a
+    //single atomic word: whoever moves it on to the next chunk with a CAS
+    //hands the chunk over, by setting its ring_used. the sender does so once
+    //the chunk passes the deadline (a quiet scene has no callbacks to do
+    //it), and a callback that loses the CAS writes its events to the next
+    //chunk instead. neither thread ever waits for the other
+    vector< vector<int32_t> > ring;
+    vector< std::atomic<int> > ring_used; //<- 0 until handed over
+    vector<double> ring_opened;
+    vector<vPacketiser::reason> ring_reason;
+    int chunk_size{0};
+    vPacketiser packetiser;
+    std::atomic<std::uint64_t> open_chunk{0}; //<- sequence << 32 | used
+    std::atomic<unsigned int> consumed{0};
+
+    static std::uint64_t pack(unsigned int seq, int used)
+    {
+        return (std::uint64_t)seq << 32 | (std::uint32_t)used;
+    }
 
 public:
 
@@ -47,7 +66,9 @@ public:
 
             yInfo() << "Bridge to push ATIS gen3 camera and raw files to YARP";
             yInfo() << "--name <str>\t: internal port name prefix";
-            yInfo() << "--buffer_size <int>\t: set initial maximum buffer size";
+            yInfo() << "--buffer_size <int>\t: total number of 32 bit ints buffered between camera and port";
+            yInfo() << "--chunks <int>\t: number of packets the buffer is split into";
+            yInfo() << "--packet_deadline <double>\t: maximum age (ms) of a packet before it is sent (0 = when the sender is idle)";
             yInfo() << "--file <str>\t: (optional) provide file path otherwise search for camera to connect";
             return false;
         }
@@ -77,9 +98,21 @@ public:
 
         //yarp::os::Network::connect(getName("/AE:o"), "/vPreProcess/AE:i", "fast_tcp");
 
-        buffer_size = rf.check("buffer_size", Value(1000000)).asInt();
-        buffer.emplace_back(vector<int32_t>(buffer_size, 0));
-        buffer.emplace_back(vector<int32_t>(buffer_size, 0));        
+        int buffer_size = rf.check("buffer_size", Value(1000000)).asInt();
+        int chunks = std::max(rf.check("chunks", Value(8)).asInt(), 2);
+        chunk_size = std::max((buffer_size / chunks) & ~1, 2);
+        ring.assign(chunks, vector<int32_t>(chunk_size, 0));
+        ring_used = vector< std::atomic<int> >(chunks);
+        ring_opened.assign(chunks, 0.0);
+        ring_reason.assign(chunks, vPacketiser::BUDGET);
+        packetiser.setBudget(chunk_size * sizeof(int32_t));
+        packetiser.setDeadline(0.001 * rf.check("packet_deadline", Value(0.0)).asDouble());
+
+        if(!rpc_port.open(getName("/rpc"))) {
+            yError() << "Could not open rpc port";
+            return false;
+        }
+        attach(rpc_port);
 
         if(rf.check("file")) {
             cam = Camera::from_file(rf.find("file").asString());
@@ -127,6 +160,17 @@ public:
         return Thread::start();
     }
 
+    bool respond(const Bottle &command, Bottle &reply) override
+    {
+        //packet budget <bytes> | packet deadline <ms> | packet stats
+        if(command.get(0).asString() == "packet") {
+            if(!packetiser.respond(command.tail(), reply))
+                reply.addString("usage: packet budget <bytes> | deadline <ms> | stats | reset");
+            return true;
+        }
+        return RFModule::respond(command, reply);
+    }
+
     double getPeriod() override
     {
         return period; //period of synchronous thread
@@ -142,6 +186,7 @@ public:
     {
         cam.stop();
         output_port.close();
+        rpc_port.close();
     }
 
     //synchronous thread
@@ -151,36 +196,108 @@ public:
                 << (counter_events * 0.001) / period << "k events sent per second";
         counter_packets = counter_events = 0;
 
+        int dropped = counter_dropped.exchange(0);
+        if(dropped)
+            yWarning() << dropped << "events dropped: sender could not keep up with"
+                       << ring.size() << "x" << chunk_size / 2 << "event buffer";
+        yInfo() << packetiser.statString();
+        packetiser.resetStats();
+
         if(!cam.is_running())
             Thread::stop();
 
         return Thread::isRunning();
     }
 
-    void fill_buffer(const EventCD *begin, const EventCD *end) {
-
-        // this loop allows us to get access to each event received in this callback
-        static AE ae;
+    //encode the address of each event with masks and shifts (same layout as
+    //AE::_coded_data) so the loop has no bitfield read-modify-writes
+    static void encode(const EventCD *ev, int n, int32_t *data)
+    {
+        for(int i = 0; i < n; i++) {
+            data[2*i] = (int32_t)ev[i].t;
+            data[2*i+1] = (ev[i].p & 0x01) | ((ev[i].x & 0x3FF) << 1) | ((ev[i].y & 0x1FF) << 12);
+        }
+    }
 
-        m.lock();
+    void hand_over(unsigned int c, int used, vPacketiser::reason reason)
+    {
+        ring_reason[c] = reason;
+        ring_used[c].store(used, std::memory_order_release);
+    }
 
-        //see if we need a bigger buffer and auto reallocate. Should only be slow at the start of operation if the
-        //buffers are set with a low value to begin with
-        if(buffer_used + (end-begin)*2 > buffer[b_sel].size()) {
-            buffer[b_sel].resize(buffer[b_sel].size() * 4);
-            yInfo() << "Buffer" << b_sel << "resized to" << buffer[b_sel].size();
-        }
+    //hand over the open chunk if it has passed the deadline while the camera
+    //delivered nothing. called by the sender, never waits for the callback
+    void hand_over_expired()
+    {
+        if(packetiser.getDeadline() <= 0)
+            return;
+
+        //ring_opened is written before the first events of a chunk are
+        //published in open_chunk, and not again until it is sent
+        std::uint64_t state = open_chunk.load(std::memory_order_acquire);
+        unsigned int p = state >> 32;
+        int used = state & 0xFFFFFFFF;
+        unsigned int c = p % ring.size();
+        if(used && packetiser.expired(ring_opened[c]) &&
+                open_chunk.compare_exchange_strong(state, pack(p + 1, 0),
+                                                   std::memory_order_acq_rel))
+            hand_over(c, used, vPacketiser::DEADLINE);
+    }
 
-        //fill up the buffer that will be sent over the port in the other thread
-        for (const EventCD *ev = begin; ev != end; ++ev) {
+    void fill_buffer(const EventCD *begin, const EventCD *end) {
 
-            ae.x = ev->x; ae.y = ev->y; ae.polarity = ev->p;
-            buffer[b_sel][buffer_used++] = ev->t;
-            buffer[b_sel][buffer_used++] = ae._coded_data;
+        //this runs in the camera SDK callback and must never wait for the
+        //sender. if the ring is full the remaining events are counted and
+        //dropped instead
+        const unsigned int n_chunks = ring.size();
+        const int budget = std::min(chunk_size,
+                std::max((int)(packetiser.getBudget() / sizeof(int32_t)) & ~1, 2));
+        std::uint64_t state = open_chunk.load(std::memory_order_acquire);
+        while(begin != end) {
+
+            unsigned int p = state >> 32;
+            int used = state & 0xFFFFFFFF;
+            if(p - consumed.load(std::memory_order_acquire) >= n_chunks) {
+                counter_dropped += end - begin;
+                return;
+            }
 
+            unsigned int c = p % n_chunks;
+            if(!used) ring_opened[c] = Time::now();
+            int n = std::max<ptrdiff_t>(std::min<ptrdiff_t>(end - begin, (budget - used) / 2), 0);
+            encode(begin, n, ring[c].data() + used);
+
+            //a chunk at the byte budget is handed over straight away. if the
+            //sender took the chunk first, state now holds the next chunk and
+            //the same events are written there
+            bool full = used + 2 * n + 2 > budget;
+            std::uint64_t next = full ? pack(p + 1, 0) : pack(p, used + 2 * n);
+            if(!open_chunk.compare_exchange_strong(state, next,
+                                                   std::memory_order_acq_rel))
+                continue;
+            if(full)
+                hand_over(c, used + 2 * n, vPacketiser::BUDGET);
+            begin += n;
+            state = next;
         }
 
-        m.unlock();
+        //a partial chunk is handed over once its oldest events pass the
+        //deadline. without a deadline it is handed over if the sender is
+        //idle, otherwise keep filling it so that packets stay large under load
+        unsigned int p = state >> 32;
+        int used = state & 0xFFFFFFFF;
+        unsigned int c = p % n_chunks;
+        if(!used) return;
+        vPacketiser::reason reason;
+        if(packetiser.expired(ring_opened[c]))
+            reason = vPacketiser::DEADLINE;
+        else if(packetiser.getDeadline() <= 0 && p == consumed.load(std::memory_order_acquire))
+            reason = vPacketiser::DRAINED;
+        else
+            return;
+        if(open_chunk.compare_exchange_strong(state, pack(p + 1, 0),
+                                              std::memory_order_acq_rel))
+            hand_over(c, used, reason);
 
     }
 
@@ -211,26 +328,27 @@ public:
     {
         while(!Thread::isStopping()) {
 
+            hand_over_expired();
+
             //if we have data to send, do so, otherwise we are just going to wait for 1 ms
-            if(buffer_used > 0) {
-
-                //switch buffers so the callback can keep filling the second buffer while we are sending
-                m.lock();
-                vector<int32_t> &current_buffer = buffer[b_sel];
-                int n_to_write = buffer_used;
-                switch_buffer(b_sel);
-                buffer_used = 0;
-                m.unlock();
-
-                //send the data in the first buffer
-                yarpstamp.update();
-                output_port.write(current_buffer, yarpstamp, n_to_write);
-                counter_packets++;
-                counter_events += n_to_write / 2;
-
-            } else {
+            unsigned int c_i = consumed.load(std::memory_order_relaxed);
+            unsigned int c = c_i % ring.size();
+            int used = ring_used[c].load(std::memory_order_acquire);
+            if(!used) {
                 Time::delay(0.001);
+                continue;
             }
+
+            //send the oldest chunk directly from the ring, then give it back
+            //to the callback
+            yarpstamp.update();
+            output_port.write(ring[c], yarpstamp, used);
+            counter_packets++;
+            counter_events += used / 2;
+            packetiser.record(used * sizeof(int32_t), ring_opened[c], ring_reason[c]);
+
+            ring_used[c].store(0, std::memory_order_relaxed);
+            consumed.store(c_i + 1, std::memory_order_release);
         }
 
     }
@@ -55,6 +55,10 @@ public:
         //set the module name used to name ports
         setName((rf.check("name", Value("/custom-dumper")).asString()).c_str());
 
+        //publish the latency histograms of the input ports
+        if(rf.check("stats") && rf.check("stats", Value(true)).asBool())
+            vTrace::setStatsPort(getName("/stats:o"));
+
         //open io ports
         if(!input_port.open(getName() + "/AE:i")) {
             yError() << "Could not open input port";
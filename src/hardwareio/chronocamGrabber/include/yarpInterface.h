@@ -27,6 +27,7 @@
 
 #include <yarp/os/all.h>
 #include <iCub/eventdriven/all.h>
+#include <event-driven/vPacketiser.h>
 #include <string>
 
 /******************************************************************************/
@@ -79,6 +80,7 @@ public:
     //virtual void onStop();          //run when stop() is called (first)
     virtual void threadRelease();   //run after thread stops (second)
     std::vector<unsigned char>& getBuffer(unsigned int &nBytesRead, unsigned int &nBytesLost);
+    unsigned int pending() { return readCount; }
 
 };
 
@@ -96,7 +98,8 @@ private:
     bool errorchecking;
     bool applyfilter;
     bool jumpcheck;
-    unsigned int chunksize;
+    ev::vPacketiser packetiser;
+    double prevFetch;
 
     //internal variables
     yarp::os::Port portvBottle;
@@ -108,6 +111,7 @@ private:
     double prevTS;
     yarp::os::Stamp vStamp;
     ev::vNoiseFilter vfilter;
+    std::vector<uint8_t> keep;
 
     //data buffer thread
     vDevReadBuffer deviceReader;
@@ -122,7 +126,8 @@ public:
     bool initialise(Chronocam::I_EventsStream &stream,
                     std::string moduleName = "", bool check = false,
                     unsigned int bufferSize = 800000,
-                    unsigned int readSize = 1024, unsigned int chunkSize = 40960);
+                    unsigned int readSize = 1024, unsigned int chunkSize = 40960,
+                    double deadline = 0.0);
     void initialiseFilter(bool applyfilter, int width, int height, int temporalsize, int spatialSize)
     {
         this->applyfilter = applyfilter;
@@ -136,6 +141,11 @@ public:
         jumpcheck = true;
     }
 
+    ev::vPacketiser &getPacketiser()
+    {
+        return packetiser;
+    }
+
     virtual void run();
     virtual void threadRelease();
     virtual void afterStart(bool success);
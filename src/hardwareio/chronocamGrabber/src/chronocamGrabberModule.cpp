@@ -95,8 +95,9 @@ bool chronocamGrabberModule::configure(yarp::os::ResourceFinder &rf) {
     int readPacketSize = 8 * rf.check("readPacketSize", yarp::os::Value("512")).asInt();
     int bufferSize     = 8 * rf.check("bufferSize", yarp::os::Value("5120")).asInt();
     int maxBottleSize  = 8 * rf.check("maxBottleSize", yarp::os::Value("5120")).asInt();
+    double packetDeadline = 0.001 * rf.check("packetDeadline", yarp::os::Value(0.0)).asDouble();
 
-    if(!D2Y.initialise(vsctrlMng.getStream(), moduleName, errorcheck, bufferSize, readPacketSize, maxBottleSize)) {
+    if(!D2Y.initialise(vsctrlMng.getStream(), moduleName, errorcheck, bufferSize, readPacketSize, maxBottleSize, packetDeadline)) {
         std::cout << "A data device was specified but could not be initialised" << std::endl;
         return false;
     } else {
@@ -172,7 +173,10 @@ bool chronocamGrabberModule::respond(const yarp::os::Bottle& command,
             "help \n" +
             "quit \n" +
             "set thr <n> ... set the threshold \n" +
-            "(where <n> is an integer number) \n";
+            "(where <n> is an integer number) \n" +
+            "packet budget <bytes> ... set the maximum packet size \n" +
+            "packet deadline <ms> ... set the maximum packet age (0 = none) \n" +
+            "packet stats ... packet size and age statistics \n";
 
     reply.clear();
 
@@ -184,6 +188,10 @@ bool chronocamGrabberModule::respond(const yarp::os::Bottle& command,
         std::cout << helpMessage;
         reply.addString("ok");
     }
+    else if (command.get(0).asString()=="packet") {
+        rec = true;
+        ok = D2Y.getPacketiser().respond(command.tail(), reply);
+    }
 
     switch (command.get(0).asVocab()) {
     case COMMAND_VOCAB_HELP:
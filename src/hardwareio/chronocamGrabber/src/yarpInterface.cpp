@@ -25,6 +25,8 @@
 
 
 
+#include <event-driven/vRawOps.h>
+
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -207,10 +209,13 @@ void vDevReadBuffer::run()
 bool device2yarp::initialise(Chronocam::I_EventsStream &stream,
                              std::string moduleName, bool check,
                              unsigned int bufferSize,
-                             unsigned int readSize, unsigned int chunkSize)
+                             unsigned int readSize, unsigned int chunkSize,
+                             double deadline)
 {
 
-    this->chunksize = chunkSize;
+    packetiser.setBudget(chunkSize);
+    packetiser.setDeadline(deadline);
+    prevFetch = yarp::os::Time::now();
     if(!deviceReader.initialise(stream, bufferSize, readSize))
         return false;
 
@@ -232,40 +237,35 @@ void device2yarp::afterStart(bool success)
 
 void device2yarp::tsjumpcheck(std::vector<unsigned char> &data, int nBytesRead)
 {
-    int pTS = *((int *)(data.data() + 0)) & 0x7FFFFFFF;
-    for(int i = 0; i < nBytesRead; i+=8) {
-        int TS =  *((int *)(data.data() + i)) & 0x7FFFFFFF;
-        int dt = TS - pTS;
-        if(dt < 0) {
-            yError() << "stamp jump" << pTS << " " << TS;
-        }
-        pTS = TS;
+    const uint32_t *raw = (const uint32_t *)data.data();
+    size_t n = nBytesRead / 8;
+    if(!n) return;
+
+    //only the events at a jump are visited individually
+    size_t i = 1;
+    while(i < n) {
+        i += ev::findStampJump(raw + 2*i, n - i, 0x7FFFFFFF, raw[2*(i-1)]);
+        if(i >= n) break;
+        yError() << "stamp jump" << (raw[2*(i-1)] & 0x7FFFFFFF) << " "
+                 << (raw[2*i] & 0x7FFFFFFF);
+        i++;
     }
 }
 
 int device2yarp::applysaltandpepperfilter(std::vector<unsigned char> &data, int nBytesRead)
 {
-    int k = 0;
-    for(int i = 0; i < nBytesRead; i+=8) {
-        int *TS =  (int *)(data.data() + i);
-
-        int *AE =  (int *)(data.data() + i + 4);
-
-        int p = (*AE)&0x01;
-        int x = ((*AE)>>1)&0x1FF;
-        int y = ((*AE)>>10)&0xFF;
-        int c = ((*AE)>>20)&0x01;
-        int ts = (*TS) & 0x00FFFFFF;
-
-        if(vfilter.check(x, y, p, c, ts)) {
-            for(int j = i; j < i+8; j++) {
-                data[k++] = data[j];
-            }
-        }
-
+    uint32_t *raw = (uint32_t *)data.data();
+    size_t n = nBytesRead / 8;
+    if(keep.size() < n) keep.resize(n);
+
+    //classify the whole packet first, then compact the survivors
+    for(size_t i = 0; i < n; i++) {
+        uint32_t AE = raw[2*i+1];
+        keep[i] = vfilter.check((AE>>1)&0x1FF, (AE>>10)&0xFF, AE&0x01,
+                                raw[2*i] & 0x00FFFFFF);
     }
 
-    return k;
+    return 8 * ev::compactEvents(raw, keep.data(), n);
 
 }
 
@@ -282,11 +282,23 @@ void  device2yarp::run() {
             std::cout << (int)((countAEs - prevAEs) / 5.0) << " v/s" << std::endl;
             std::cout << "                         Lost: ";
             std::cout << (int)(countLoss / 5.0) << " v/s" << std::endl;
+            std::cout << "                      Packets: ";
+            std::cout << packetiser.statString() << std::endl;
+            packetiser.resetStats();
             countLoss = 0;
             prevTS = yarp::os::Time::now();
             prevAEs = countAEs;
         }
 
+        //with a deadline, wait until a full packet is buffered or the oldest
+        //buffered data reaches the deadline before taking the buffer
+        while(packetiser.getDeadline() > 0 && !isStopping() &&
+              deviceReader.pending() < packetiser.getBudget() &&
+              !packetiser.expired(prevFetch))
+            yarp::os::Time::delay(0.0002);
+        double opened = prevFetch;
+        prevFetch = yarp::os::Time::now();
+
         //get the data from the device read thread
         unsigned int nBytesRead, nBytesLost;
         std::vector<unsigned char> &data = deviceReader.getBuffer(nBytesRead, nBytesLost);
@@ -322,7 +334,7 @@ void  device2yarp::run() {
     //std::cout << *(int*)data.data() << std::endl;
         //typical ZYNQ behaviour to skip error checking
         unsigned int i = 0;
-        i = 0;
+        unsigned int chunksize = std::max((unsigned int)packetiser.getBudget(), 8u) & ~0x07;
         if(!errorchecking && !dataError) {
 
             while((i+1) * chunksize < nBytesRead) {
@@ -334,6 +346,7 @@ void  device2yarp::run() {
                 portvBottle.write(external_storage);
                 //portvBottle.write(strict);
                 //portvBottle.waitForWrite();
+                packetiser.record(chunksize, opened, ev::vPacketiser::BUDGET);
 
                 i++;
             }
@@ -345,6 +358,10 @@ void  device2yarp::run() {
             portvBottle.write(external_storage);
             //portvBottle.write(strict);
             //portvBottle.waitForWrite();
+            packetiser.record(nBytesRead - i*chunksize, opened,
+                              nBytesRead - i*chunksize >= chunksize ? ev::vPacketiser::BUDGET :
+                              packetiser.getDeadline() > 0 ? ev::vPacketiser::DEADLINE :
+                                                             ev::vPacketiser::DRAINED);
 
             continue;						//return here.
         }
@@ -52,8 +52,14 @@ public:
         //set the module name used to name ports
         setName((rf.check("name", Value("/qadIMUcal")).asString()).c_str());
 
-        //open io ports
-        if(!imu_port.open(getName() + "/IMU:i")) {
+        //publish the latency histograms of the input ports
+        if(rf.check("stats") && rf.check("stats", Value(true)).asBool())
+            vTrace::setStatsPort(getName("/stats:o"));
+
+        //open io ports (--shm_source names an IMU port to read through shared
+        //memory, e.g. /vPreProcess/imu_samples:o)
+        std::string shm_source = rf.check("shm_source", Value("")).asString();
+        if(!imu_port.open(getName() + "/IMU:i", shm_source)) {
             yError() << "Could not open input port";
             return false;
         }
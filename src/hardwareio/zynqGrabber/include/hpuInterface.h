@@ -22,8 +22,10 @@
 
 #include <yarp/os/all.h>
 #include <event-driven/all.h>
+#include <event-driven/vPacketiser.h>
 #include <string>
 #include <vector>
+#include <atomic>
 
 /******************************************************************************/
 //device2yarp
@@ -34,19 +36,19 @@ private:
 
     //data buffer thread
     int fd;
-    std::vector<unsigned char> data;
     yarp::os::BufferedPort<ev::vPortableInterface> output_port;
     yarp::os::Stamp yarp_stamp;
 
     //parameters
     unsigned int max_dma_pool_size;
-    unsigned int max_packet_size;
+    ev::vPacketiser packetiser;
 
 public:
 
     device2yarp();
     bool open(string module_name, int fd, unsigned int pool_size,
-              unsigned int packet_size);
+              unsigned int packet_size, double deadline = 0.0);
+    ev::vPacketiser &getPacketiser() { return packetiser; }
 
     void run();
     void onStop();
@@ -60,17 +62,42 @@ class yarp2device : public Thread
 {
 protected:
 
+    //writes filled ring slots to the device so that receiving the next
+    //packet from the port and writing the current one to the HPU overlap
+    class deviceWriter : public Thread
+    {
+    private:
+        yarp2device *parent;
+    public:
+        deviceWriter(yarp2device *parent) : parent(parent) {}
+        void run();
+        void onStop();
+    };
+
     int fd;
     bool valid;
-    yarp::os::BufferedPort<Bottle> input_port;
-    std::vector<int> data_copy;
+    yarp::os::Port input_port;
+
+    //ring of receive buffers. each packet is read straight into a slot and
+    //handed to the device from the same memory
+    std::vector<ev::vPortableInterface> ring;
+    Semaphore slots_free;
+    Semaphore slots_filled;
+    unsigned int head;
+    unsigned int tail;
+    std::atomic<unsigned int> queued;
+    deviceWriter writer;
 
     unsigned int total_events;
+    unsigned int failed_packets;
+
+    bool writeSlot(const ev::vPortableInterface &slot);
+    void reportRate();
 
 public:
 
     yarp2device();
-    bool open(string module_name, int fd);
+    bool open(string module_name, int fd, unsigned int n_buffers = 4);
     void run();
     void onStop();
 
@@ -98,8 +125,11 @@ public:
 
     bool configureDevice(string device_name, bool spinnaker = false,
                          bool loopback = false);
-    bool openReadPort(string module_name, unsigned int packet_size);
-    bool openWritePort(string module_name);
+    bool openReadPort(string module_name, unsigned int packet_size,
+                      double deadline = 0.0);
+    ev::vPacketiser &packetiser() { return D2Y.getPacketiser(); }
+    bool isReading() { return read_thread_open; }
+    bool openWritePort(string module_name, unsigned int n_buffers = 4);
     void start();
     void stop();
 
@@ -41,11 +41,10 @@ device2yarp::device2yarp()
 {
     fd = -1;
     max_dma_pool_size = 0;
-    max_packet_size = 0;
 }
 
 bool device2yarp::open(string module_name, int fd, unsigned int pool_size,
-                       unsigned int packet_size)
+                       unsigned int packet_size, double deadline)
 {
     this->fd = fd;
 
@@ -53,10 +52,9 @@ bool device2yarp::open(string module_name, int fd, unsigned int pool_size,
         packet_size = pool_size;
         yWarning() << "Setting packet_size to pool_size:" << packet_size;
     }
-    this->max_packet_size = packet_size;
     this->max_dma_pool_size = pool_size;
-
-    data.resize(max_packet_size);
+    packetiser.setBudget(packet_size);
+    packetiser.setDeadline(deadline);
 
     return output_port.open(module_name + "/AE:o");
 }
@@ -73,18 +71,38 @@ void  device2yarp::run() {
 
     while(!isStopping()) {
 
+        //the budget can change at runtime, but never below a dma pool
+        unsigned int budget = std::max((unsigned int)packetiser.getBudget(),
+                                       max_dma_pool_size) & ~0x07;
         vPortableInterface& external_storage = output_port.prepare();
         external_storage.setHeader(AE::tag);
-        external_storage.internaldata.resize(max_packet_size / 4);
+        external_storage.internaldata.resize(budget / 4);
 
-        int r = max_dma_pool_size;
+        //read until the byte budget is met or the oldest data passes the
+        //deadline. without a deadline stop as soon as the device has
+        //delivered less than a full pool
+        vPacketiser::reason why = vPacketiser::BUDGET;
+        double opened = 0.0;
         unsigned int n_bytes_read = 0;
-        while(r >= (int)max_dma_pool_size && n_bytes_read < max_packet_size) {
-            r = read(fd, (char *)external_storage.internaldata.data() + n_bytes_read, max_packet_size - n_bytes_read);
+        while(n_bytes_read < budget) {
+            int r = read(fd, (char *)external_storage.internaldata.data() + n_bytes_read, budget - n_bytes_read);
             if(r < 0)
                 yInfo() << "[READ ]" << std::strerror(errno);
-            else
+            else if(r > 0) {
+                if(!n_bytes_read) opened = yarp::os::Time::now();
                 n_bytes_read += r;
+            }
+
+            if(n_bytes_read >= budget) break;
+            if(n_bytes_read && packetiser.expired(opened)) {
+                why = vPacketiser::DEADLINE;
+                break;
+            }
+            if(r < (int)max_dma_pool_size && packetiser.getDeadline() <= 0) {
+                why = vPacketiser::DRAINED;
+                break;
+            }
+            if(isStopping()) break;
         }
 
         if(n_bytes_read == 0) {
@@ -92,7 +110,7 @@ void  device2yarp::run() {
             continue;
         }
 
-        unsigned int first_ts = *(unsigned int *)data.data();
+        unsigned int first_ts = external_storage.internaldata[0];
         if(prev_ts > first_ts)
             yWarning() << prev_ts << "->" << first_ts;
         prev_ts = first_ts;
@@ -104,6 +122,7 @@ void  device2yarp::run() {
         output_port.writeStrict();
 
         event_count += n_bytes_read / 8;
+        packetiser.record(n_bytes_read, opened, why);
 
         static double prev_ts = yarp::os::Time::now();
         double update_period = yarp::os::Time::now() - prev_ts;
@@ -111,7 +130,8 @@ void  device2yarp::run() {
 
             yInfo() << "[READ ]"
                     << (int)(event_count/(1000.0*update_period))
-                    << "k events/s";
+                    << "k events/s," << packetiser.statString();
+            packetiser.resetStats();
 
             prev_ts += update_period;
             event_count = 0;
@@ -128,16 +148,26 @@ void device2yarp::onStop()
 /******************************************************************************/
 //yarp2device
 /******************************************************************************/
-yarp2device::yarp2device()
+yarp2device::yarp2device() : slots_free(0), slots_filled(0), writer(this)
 {
     fd = -1;
+    head = tail = 0;
+    queued = 0;
     total_events = 0;
+    failed_packets = 0;
 }
 
-bool yarp2device::open(std::string module_name, int fd)
+bool yarp2device::open(std::string module_name, int fd, unsigned int n_buffers)
 {
     this->fd = fd;
-    input_port.setStrict();
+
+    if(n_buffers < 2) n_buffers = 2;
+    ring.resize(n_buffers);
+    head = tail = 0;
+    queued = 0;
+    for(unsigned int i = 0; i < n_buffers; i++)
+        slots_free.post();
+
     return input_port.open(module_name + "/AE:i");
 }
 
@@ -145,72 +175,117 @@ void yarp2device::onStop()
 {
     input_port.interrupt();
     input_port.close();
+    slots_free.post(); //release a receive waiting on a full ring
+    writer.stop();
 }
 
 void yarp2device::run()
 {
+    if(fd < 0) {
+        yError() << "HPU writing device not open";
+        return;
+    }
 
+    writer.start();
+
+    //the port reads the packet straight into the next free slot. the writer
+    //thread hands that memory to the device while we receive the next one
     while(true) {
 
-        Bottle *yarp_bottle = input_port.read(true); //blocking read
-        //std::cout << ".";
-        if(!yarp_bottle) return; //when interrupt is called returns null
+        slots_free.wait();
+        if(isStopping()) break;
 
-        Bottle *data_bottle = yarp_bottle->get(1).asList();
+        vPortableInterface &slot = ring[head];
+        if(!input_port.read(slot)) { //returns false when interrupted
+            if(isStopping()) break;
+            yWarning() << "[WRITE] Could not read packet";
+            slots_free.post();
+            continue;
+        }
 
-        size_t data_size = data_bottle->size();
-        if(data_size > data_copy.size())
-            data_copy.resize(data_size, 0);
+        if(!slot.readSize()) {
+            slots_free.post();
+            continue;
+        }
 
-        //copy to internal data (needed to modify the contents)
-        //we can remove data_copy and just use data_bottle when the
-        //mask is done in the FPGA
-        for(size_t i = 0; i < data_size; i += 1)
-            data_copy[i] = data_bottle->get(i).asInt();
+        head = (head + 1) % ring.size();
+        queued++;
+        slots_filled.post();
+    }
 
+}
 
-        //move to bytes space
-        char * buffer = (char *)data_copy.data();
-        size_t bytes_to_write = data_size * sizeof(int);
-        size_t written = 0;
-        while(written < bytes_to_write) {
+bool yarp2device::writeSlot(const vPortableInterface &slot)
+{
+    const char * buffer = (const char *)slot.readData();
+    size_t bytes_to_write = slot.readSize() * sizeof(int32_t);
+    size_t written = 0;
+    while(written < bytes_to_write) {
 
-            int ret = write(fd, buffer + written, bytes_to_write - written);
+        int ret = write(fd, buffer + written, bytes_to_write - written);
 
-            if(ret > 0) { //success!
-                written += ret;
-            } else if(ret < 0 && errno != EAGAIN) { //error!
+        if(ret > 0) { //success!
+            written += ret;
+        } else if(ret < 0 && errno != EAGAIN) { //error!
+            if(!failed_packets) //the rest are counted in reportRate()
                 perror("Error writing to device: ");
-                return;
-            }
+            return false;
         }
+    }
 
-        total_events += written / (2.0 * sizeof(int));
-
-        static double previous_time = yarp::os::Time::now();
-        double dt = yarp::os::Time::now() - previous_time;
-        if(dt > 5.0) {
+    total_events += written / (2.0 * sizeof(int));
+    return true;
+}
 
-            hpu_regs_t hpu_regs = {0x18, 0, 0};
-            if (-1 == ioctl(fd, HPU_GEN_REG, &hpu_regs)){
-                yWarning() << "Couldn't read dump status";
-            }
+void yarp2device::reportRate()
+{
+    static double previous_time = yarp::os::Time::now();
+    double dt = yarp::os::Time::now() - previous_time;
+    if(dt > 5.0) {
 
-            if(hpu_regs.data & 0x00100000) {
-                yInfo() << "[DUMP ] " << (int)(0.001 * total_events / dt) << " k events/s ("
-                    << input_port.getPendingReads() << " delayed packets)";
-            } else {
-                yInfo() << "[WRITE] " << (int)(0.001 * total_events / dt) << " k events/s ("
-                    << input_port.getPendingReads() << " delayed packets)";
-            }
+        hpu_regs_t hpu_regs = {0x18, 0, 0};
+        if (-1 == ioctl(fd, HPU_GEN_REG, &hpu_regs)){
+            yWarning() << "Couldn't read dump status";
+        }
 
-            total_events = 0;
-            previous_time += dt;
+        if(hpu_regs.data & 0x00100000) {
+            yInfo() << "[DUMP ] " << (int)(0.001 * total_events / dt) << " k events/s ("
+                << (int)queued << "/" << (int)ring.size() << " buffered packets)";
+        } else {
+            yInfo() << "[WRITE] " << (int)(0.001 * total_events / dt) << " k events/s ("
+                << (int)queued << "/" << (int)ring.size() << " buffered packets)";
         }
+        if(failed_packets)
+            yWarning() << "[WRITE] " << failed_packets << " packets could not be written";
 
+        total_events = 0;
+        failed_packets = 0;
+        previous_time += dt;
     }
+}
+
+void yarp2device::deviceWriter::run()
+{
+    while(true) {
+
+        parent->slots_filled.wait();
+        if(isStopping()) return;
 
+        //a packet the device refused is dropped, but the ring keeps draining
+        //so that the reader is never left waiting for a free slot
+        if(!parent->writeSlot(parent->ring[parent->tail]))
+            parent->failed_packets++;
+        parent->tail = (parent->tail + 1) % parent->ring.size();
+        parent->queued--;
+        parent->slots_free.post();
 
+        parent->reportRate();
+    }
+}
+
+void yarp2device::deviceWriter::onStop()
+{
+    parent->slots_filled.post();
 }
 
 /******************************************************************************/
@@ -366,9 +441,10 @@ bool hpuInterface::configureDevice(string device_name, bool spinnaker, bool loop
     return true;
 }
 
-bool hpuInterface::openReadPort(string module_name, unsigned int packet_size)
+bool hpuInterface::openReadPort(string module_name, unsigned int packet_size,
+                                double deadline)
 {
-    if(fd < 0 || !D2Y.open(module_name, fd, pool_size, packet_size))
+    if(fd < 0 || !D2Y.open(module_name, fd, pool_size, packet_size, deadline))
         return false;
 
     yInfo() << "Maximum packet size:" << packet_size;
@@ -376,9 +452,9 @@ bool hpuInterface::openReadPort(string module_name, unsigned int packet_size)
     return true;
 }
 
-bool hpuInterface::openWritePort(string module_name)
+bool hpuInterface::openWritePort(string module_name, unsigned int n_buffers)
 {
-    if(fd < 0 || !Y2D.open(module_name, fd))
+    if(fd < 0 || !Y2D.open(module_name, fd, n_buffers))
         return false;
 
     write_thread_open = true;
@@ -207,13 +207,15 @@ bool zynqGrabberModule::configure(yarp::os::ResourceFinder &rf) {
         bool write_flag = rf.check("hpu_write") &&
                 rf.check("hpu_write", yarp::os::Value(true)).asBool();
         int packet_size = 8 * rf.check("packet_size", yarp::os::Value("5120")).asInt();
+        int write_buffers = rf.check("write_buffers", yarp::os::Value(4)).asInt();
+        double packet_deadline = 0.001 * rf.check("packet_deadline", yarp::os::Value(0.0)).asDouble();
 
         if(read_flag)
-            if(!hpu.openReadPort(moduleName, packet_size))
+            if(!hpu.openReadPort(moduleName, packet_size, packet_deadline))
                 return false;
 
         if(write_flag)
-            if(!hpu.openWritePort(moduleName))
+            if(!hpu.openWritePort(moduleName, write_buffers))
                 return false;
 
         yInfo() << "Starting HPU read/write threads";
@@ -272,7 +274,10 @@ bool zynqGrabberModule::respond(const yarp::os::Bottle& command,
             "help \n" +
             "quit \n" +
             "set thr <n> ... set the threshold \n" +
-            "(where <n> is an integer number) \n";
+            "(where <n> is an integer number) \n" +
+            "packet budget <bytes> ... set the maximum packet size \n" +
+            "packet deadline <ms> ... set the maximum packet age (0 = none) \n" +
+            "packet stats ... packet size and age statistics \n";
 
     reply.clear();
 
@@ -284,6 +289,10 @@ bool zynqGrabberModule::respond(const yarp::os::Bottle& command,
         std::cout << helpMessage;
         reply.addString("ok");
     }
+    else if (command.get(0).asString()=="packet") {
+        rec = true;
+        ok = hpu.isReading() && hpu.packetiser().respond(command.tail(), reply);
+    }
 
     switch (command.get(0).asVocab()) {
     case COMMAND_VOCAB_HELP:
@@ -123,6 +123,12 @@ private :
     int rightXOffset;
     int rightYOffset;
 
+    //per sensor pixel destination on the canvas (built after calibration)
+    std::vector<cv::Point> leftLUT;
+    std::vector<cv::Point> rightLUT;
+    std::vector<ev::AE> batch;
+    std::vector<ev::AE> transformed;
+
 
 public :
 
@@ -143,8 +149,21 @@ public :
     bool readConfigFile( const yarp::os::ResourceFinder &rf, std::string groupName
                          , yarp::sig::Matrix &homography ) const;
 
-    void transform( yarp::sig::ImageOf<yarp::sig::PixelBgr> &img, const ev::vQueue &vQueue
-                    , const yarp::sig::Matrix &homography, int xOffset, int yOffset ) ;
+    void buildLUT( const yarp::sig::Matrix &homography, int xOffset, int yOffset
+                   , std::vector<cv::Point> &lut ) const;
+
+    cv::Point transformPoint( const yarp::sig::Matrix &homography, int x, int y
+                              , int xOffset, int yOffset ) const;
+
+    void transform( const std::vector<ev::AE> &in, std::vector<ev::AE> &out
+                    , const std::vector<cv::Point> &lut, const yarp::sig::Matrix &homography
+                    , int xOffset, int yOffset ) const;
+
+    void drawOverlay( yarp::sig::ImageOf<yarp::sig::PixelBgr> &canvas
+                      , yarp::sig::ImageOf<yarp::sig::PixelBgr> &img, int xOffset, int yOffset
+                      , const std::vector<ev::AE> &events ) const;
+
+    void sendEvents( const std::vector<ev::AE> &events );
 
     void getCanvasSize( const yarp::sig::Matrix &homography, int &canvasWidth, int &canvasHeight, int &xOffset
                             , int &yOffset ) const;
@@ -103,6 +103,10 @@ bool DualCamTransformModule::updateModule() {
             getCanvasSize( leftH, leftCanvasWidth, leftCanvasHeight, leftXOffset, leftYOffset );
             getCanvasSize( rightH, rightCanvasWidth, rightCanvasHeight, rightXOffset, rightYOffset );
         }
+
+        //the homographies are now fixed
+        buildLUT( leftH, leftXOffset, leftYOffset, leftLUT );
+        buildLUT( rightH, rightXOffset, rightYOffset, rightLUT );
     }
 
 
@@ -112,17 +116,16 @@ bool DualCamTransformModule::updateModule() {
         yarp::sig::ImageOf<yarp::sig::PixelBgr> &leftCanvas = leftImagePortOut.prepare();
         yarp::sig::ImageOf<yarp::sig::PixelBgr > leftImg = leftImageCollector.getImage();
 
-      leftCanvas.resize(std::max(leftCanvasWidth, (int)(leftXOffset + leftImg.width())),
+        leftCanvas.resize(std::max(leftCanvasWidth, (int)(leftXOffset + leftImg.width())),
                           std::max(leftCanvasHeight, (int)(leftYOffset + leftImg.height())));
 
-        leftCanvas.zero();
-        for ( int x = 0; x < (int)leftImg.width(); ++x ) {
-            for ( int y = 0; y < (int)leftImg.height(); ++y ) {
-                leftCanvas(x + leftXOffset, y + leftYOffset) = leftImg(x,y);
-            }
-        }
         ev::vQueue vLeftQueue = eventCollector.getEventsFromChannel(0);
-        transform( leftCanvas, vLeftQueue, leftH, leftXOffset, leftYOffset );
+        batch.clear();
+        for ( auto &it : vLeftQueue )
+            batch.push_back( *is_event<AE>( it ) );
+        transform( batch, transformed, leftLUT, leftH, leftXOffset, leftYOffset );
+        drawOverlay( leftCanvas, leftImg, leftXOffset, leftYOffset, transformed );
+        sendEvents( transformed );
         leftImagePortOut.write();
     }
 
@@ -130,17 +133,16 @@ bool DualCamTransformModule::updateModule() {
         yarp::sig::ImageOf<yarp::sig::PixelBgr> &rightCanvas = rightImagePortOut.prepare();
         yarp::sig::ImageOf<yarp::sig::PixelBgr > rightImg = rightImageCollector.getImage();
 
-      rightCanvas.resize(std::max(rightCanvasWidth, (int)(rightXOffset + rightImg.width())),
-                          std::max(rightCanvasHeight,(int)(rightYOffset + rightImg.height())));
+        rightCanvas.resize(std::max(rightCanvasWidth, (int)(rightXOffset + rightImg.width())),
+                           std::max(rightCanvasHeight,(int)(rightYOffset + rightImg.height())));
 
-        rightCanvas.zero();
-        for ( int x = 0; x < (int)rightImg.width(); ++x ) {
-            for ( int y = 0; y < (int)rightImg.height(); ++y ) {
-                rightCanvas(x + rightXOffset, y + rightYOffset) = rightImg(x,y);
-            }
-        }
         ev::vQueue vRightQueue = eventCollector.getEventsFromChannel(1);
-        transform( rightCanvas, vRightQueue, rightH, rightXOffset, rightYOffset );
+        batch.clear();
+        for ( auto &it : vRightQueue )
+            batch.push_back( *is_event<AE>( it ) );
+        transform( batch, transformed, rightLUT, rightH, rightXOffset, rightYOffset );
+        drawOverlay( rightCanvas, rightImg, rightXOffset, rightYOffset, transformed );
+        sendEvents( transformed );
         rightImagePortOut.write();
     }
 
@@ -149,48 +151,83 @@ bool DualCamTransformModule::updateModule() {
 
 }
 
-void DualCamTransformModule::transform( yarp::sig::ImageOf<yarp::sig::PixelBgr> &img, const vQueue &vQueue
-                                        , const yarp::sig::Matrix &homography, int xOffset, int yOffset ) {
-    ev::vBottle &outBottle = vPortOut.prepare();
-    outBottle.clear();
-    for ( auto &it : vQueue ) {
+cv::Point DualCamTransformModule::transformPoint( const yarp::sig::Matrix &homography, int x, int y
+                                                  , int xOffset, int yOffset ) const {
+    //homogeneous coordinates (row vector), the homography is stored transposed
+    double hx = x * homography(0, 0) + y * homography(1, 0) + homography(2, 0);
+    double hy = x * homography(0, 1) + y * homography(1, 1) + homography(2, 1);
+    double hz = x * homography(0, 2) + y * homography(1, 2) + homography(2, 2);
 
-        auto v = is_event<AE >( it );
+    return cv::Point( std::floor( hx / hz + xOffset + 1 ),
+                      std::floor( hy / hz + yOffset + 1 ) );
+}
 
-        double x = v->x;
-        double y = v->y;
-        yarp::sig::Vector evCoord( 3 );
+void DualCamTransformModule::buildLUT( const yarp::sig::Matrix &homography, int xOffset, int yOffset
+                                       , std::vector<cv::Point> &lut ) const {
+    lut.resize( width * height );
+    for ( int y = 0; y < height; ++y ) {
+        for ( int x = 0; x < width; ++x ) {
+            lut[y * width + x] = transformPoint( homography, x, y, xOffset, yOffset );
+        }
+    }
+}
 
-        //Converting to homogeneous coordinates
-        evCoord[0] = x;
-        evCoord[1] = y;
-        evCoord[2] = 1;
+void DualCamTransformModule::transform( const std::vector<AE> &in, std::vector<AE> &out
+                                        , const std::vector<cv::Point> &lut, const yarp::sig::Matrix &homography
+                                        , int xOffset, int yOffset ) const {
+    out.clear();
+    out.reserve( in.size() );
+    for ( auto &v : in ) {
 
-        //Applying trasformation
-        evCoord *= homography;
+        cv::Point p;
+        if ( v.x < width && v.y < height && !lut.empty() )
+            p = lut[v.y * width + v.x];
+        else
+            p = transformPoint( homography, v.x, v.y, xOffset, yOffset );
 
-        //Converting back from homogenous coordinates
-        x = (evCoord[0] / evCoord[2]) + xOffset + 1;
-        y = (evCoord[1] / evCoord[2]) + yOffset + 1;
+        //only events that can be encoded are kept
+        if ( p.x < 0 || p.y < 0 || p.y > 255 )
+            continue;
 
-        //Drawing event on img
-        bool inBound = x >= 0 && x < img.width() && y >= 0 && y < img.height();
-        if (inBound){
-            img( x, y ) = yarp::sig::PixelBgr( 255, 255, 255 );
-        }
+        out.push_back( v );
+        out.back().x = p.x;
+        out.back().y = p.y;
+    }
+}
 
-        if (y <= 255) {
-            outBottle.addEvent( v );
-            v->x = x;
-            v->y = y;
-        }
+void DualCamTransformModule::drawOverlay( yarp::sig::ImageOf<yarp::sig::PixelBgr> &canvas
+                                          , yarp::sig::ImageOf<yarp::sig::PixelBgr> &img, int xOffset, int yOffset
+                                          , const std::vector<AE> &events ) const {
+    cv::Mat canvasMat = yarp::cv::toCvMat( canvas );
+    cv::Mat imgMat = yarp::cv::toCvMat( img );
+    canvasMat.setTo( 0 );
+
+    //bulk copy of the frame into the (clipped) offset region of the canvas
+    cv::Rect dst( xOffset, yOffset, imgMat.cols, imgMat.rows );
+    cv::Rect roi = dst & cv::Rect( 0, 0, canvasMat.cols, canvasMat.rows );
+    if ( roi.area() > 0 ) {
+        imgMat( cv::Rect( roi.x - xOffset, roi.y - yOffset, roi.width, roi.height ) )
+                .copyTo( canvasMat( roi ) );
     }
-    if (outBottle.size() > 0) {
-//        vPortOut.setEnvelope(vQueue.back()->stamp);
-        vPortOut.write();
+
+    for ( auto &v : events ) {
+        if ( v.x < canvasMat.cols && v.y < canvasMat.rows )
+            canvasMat.at<cv::Vec3b>( v.y, v.x ) = cv::Vec3b( 255, 255, 255 );
     }
 }
 
+void DualCamTransformModule::sendEvents( const std::vector<AE> &events ) {
+    if ( events.empty() )
+        return;
+
+    ev::vBottle &outBottle = vPortOut.prepare();
+    outBottle.clear();
+    for ( auto &v : events )
+        outBottle.addEvent( std::make_shared<AE>( v ) );
+//    vPortOut.setEnvelope(vQueue.back()->stamp);
+    vPortOut.write();
+}
+
 void DualCamTransformModule::finalizeCalibration( yarp::sig::Matrix &homography, std::string groupName) {
 
     homography /= nIter;
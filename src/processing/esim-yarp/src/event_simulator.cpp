@@ -34,6 +34,9 @@
 #include <yarp/cv/Cv.h>
 
 #include <random>
+#include <fstream>
+#include <algorithm>
+#include <thread>
 #include <opencv2/core/core.hpp>
 #include <opencv2/opencv.hpp>
 #include "opencv2/imgproc/imgproc.hpp"
@@ -44,7 +47,238 @@ using namespace yarp::sig;
 using namespace yarp::os;
 using namespace cv;
 using namespace ev;
-using std::deque;
+using std::vector;
+
+struct esimConfig
+{
+    double C;
+    double log_eps;
+    double noise_variance;
+    bool use_log_image;
+    int max_events; /// per pixel per frame
+};
+
+/**
+ * @brief The esimCore class is the simulator itself. The image is split in
+ * bands of rows processed in parallel in float32. Each pixel emits one event
+ * per contrast threshold crossing with a timestamp linearly interpolated
+ * between the two frames, and the output is sorted in time.
+ */
+class esimCore
+{
+
+private:
+
+    class bandWorker : public yarp::os::Thread
+    {
+    private:
+
+        esimCore *core;
+        yarp::os::Semaphore go;
+        yarp::os::Semaphore &done;
+
+    public:
+
+        int r0, r1; /// band of rows [r0, r1)
+        vector<AE> events;
+
+        bandWorker(esimCore *core, yarp::os::Semaphore &done) :
+            core(core), go(0), done(done), r0(0), r1(0) {}
+        void trigger() { go.post(); }
+        void onStop() { go.post(); }
+        void run()
+        {
+            while(true) {
+                go.wait();
+                if(isStopping()) break;
+                core->processBand(r0, r1, events);
+                done.post();
+            }
+        }
+    };
+
+    esimConfig config;
+    int threads;
+
+    cv::Mat grey;       /// CV_8U
+    cv::Mat img32;      /// CV_32F (log) intensity
+    cv::Mat prev_img;   /// CV_32F
+    cv::Mat ref_values; /// CV_32F change since the last event
+    cv::Mat noise;      /// CV_32F
+
+    //current frame
+    const cv::Mat *input;
+    double delta_t;
+    float dt_ticks;
+
+    //worker pool
+    vector<bandWorker *> workers;
+    yarp::os::Semaphore done;
+    int own_r0, own_r1;
+    vector<AE> own_events;
+
+    void initialise(const cv::Mat &img)
+    {
+        grey = cv::Mat(img.size(), CV_8U);
+        img32 = cv::Mat(img.size(), CV_32F);
+        prev_img = cv::Mat(img.size(), CV_32F);
+        ref_values = cv::Mat::zeros(img.size(), CV_32F);
+        noise = cv::Mat::zeros(img.size(), CV_32F);
+
+        //split the rows, the calling thread processes the first band
+        int n = std::max(1, std::min(threads, img.rows));
+        int rows = (img.rows + n - 1) / n;
+        own_r0 = 0; own_r1 = std::min(rows, img.rows);
+        for(int i = 1; i < n; i++) {
+            bandWorker *w = new bandWorker(this, done);
+            w->r0 = std::min(i * rows, img.rows);
+            w->r1 = std::min((i + 1) * rows, img.rows);
+            w->start();
+            workers.push_back(w);
+        }
+    }
+
+    //(grey, float, log) pre-processing of the rows [r0, r1)
+    void preprocess(int r0, int r1)
+    {
+        static constexpr double pixelscaler = 1.0 / 255.0;
+        cv::Mat in = input->rowRange(r0, r1);
+        cv::Mat band = img32.rowRange(r0, r1);
+        if(in.channels() > 1) {
+            cv::Mat gband = grey.rowRange(r0, r1);
+            cvtColor(in, gband, COLOR_RGB2GRAY);
+            gband.convertTo(band, CV_32F, pixelscaler);
+        } else {
+            in.convertTo(band, CV_32F, pixelscaler);
+        }
+
+        if(config.use_log_image) {
+            band += config.log_eps;
+            cv::log(band, band);
+        }
+    }
+
+public:
+
+    esimCore() : threads(1), input(nullptr), delta_t(0.0), dt_ticks(0.0f),
+        done(0), own_r0(0), own_r1(0) {}
+
+    ~esimCore()
+    {
+        for(auto w : workers) {
+            w->stop();
+            delete w;
+        }
+    }
+
+    ///
+    /// \brief configure the simulator
+    /// \param threads number of threads (0 = number of cores)
+    ///
+    void configure(const esimConfig &config, int threads)
+    {
+        this->config = config;
+        if(threads <= 0)
+            threads = std::thread::hardware_concurrency();
+        this->threads = std::max(threads, 1);
+    }
+
+    void processBand(int r0, int r1, vector<AE> &events)
+    {
+        events.clear();
+        preprocess(r0, r1);
+
+        cv::Mat nband = noise.rowRange(r0, r1);
+        cv::randn(nband, 0, config.noise_variance * delta_t);
+
+        const float C = config.C;
+        AE v;
+        for(int y = r0; y < r1; y++) {
+            const float *cur = img32.ptr<float>(y);
+            const float *nz = noise.ptr<float>(y);
+            float *prev = prev_img.ptr<float>(y);
+            float *ref = ref_values.ptr<float>(y);
+            for(int x = 0; x < img32.cols; x++) {
+
+                float a0 = ref[x];
+                float a1 = a0 + (cur[x] - prev[x]) + nz[x];
+                prev[x] = cur[x];
+
+                if(a1 < C && a1 > -C) {
+                    ref[x] = a1;
+                    continue;
+                }
+
+                //one event for each level crossed, the time of the crossing
+                //is interpolated between the previous and current frame
+                float sign = a1 > 0.0f ? 1.0f : -1.0f;
+                int n = std::min((int)(sign * a1 / C), config.max_events);
+                float inv = dt_ticks / (a1 - a0);
+                v.x = x;
+                v.y = y;
+                v.polarity = sign > 0.0f ? 0 : 1;
+                for(int k = 1; k <= n; k++) {
+                    float t = (sign * k * C - a0) * inv;
+                    v.stamp = (unsigned int)std::max(0.0f, std::min(t, dt_ticks));
+                    events.push_back(v);
+                }
+                ref[x] = std::fmod(a1, C);
+            }
+        }
+
+        std::stable_sort(events.begin(), events.end(),
+                         [](const AE &a, const AE &b) { return a.stamp < b.stamp; });
+    }
+
+    ///
+    /// \brief process a new image
+    /// \param img is the RGB or mono image
+    /// \param prev_time is the time of the previous image (seconds)
+    /// \param curr_time is the time of this image (seconds)
+    /// \param events are the time-sorted output events
+    ///
+    void process(const cv::Mat &img, double prev_time, double curr_time,
+                 vector<AE> &events)
+    {
+        events.clear();
+        input = &img;
+
+        //if first image we need to initialise based on the image size
+        if(prev_img.empty()) {
+            initialise(img);
+            preprocess(0, img.rows);
+            img32.copyTo(prev_img);
+            yInfo() << "Initialized event camera simulator with sensor size: "
+                    << prev_img.cols << "x" << prev_img.rows
+                    << "using" << workers.size() + 1 << "threads";
+            return; //do not produce events on the first image
+        }
+
+        delta_t = std::max(curr_time - prev_time, 0.0);
+        dt_ticks = delta_t * vtsHelper::vtsscaler;
+
+        for(auto w : workers)
+            w->trigger();
+        processBand(own_r0, own_r1, own_events);
+        for(unsigned int i = 0; i < workers.size(); i++)
+            done.wait();
+
+        //merge the sorted bands
+        events.insert(events.end(), own_events.begin(), own_events.end());
+        for(auto w : workers) {
+            size_t mid = events.size();
+            events.insert(events.end(), w->events.begin(), w->events.end());
+            std::inplace_merge(events.begin(), events.begin() + mid, events.end(),
+                               [](const AE &a, const AE &b) { return a.stamp < b.stamp; });
+        }
+
+        //offset from the previous frame to the ATIS clock
+        long long int base = prev_time * vtsHelper::vtsscaler;
+        for(auto &e : events)
+            e.stamp = (base + e.stamp) % vtsHelper::max_stamp;
+    }
+
+};
 
 class EsimModule : public yarp::os::RFModule,
                    public yarp::os::Thread
@@ -55,28 +289,94 @@ private:
     BufferedPort< ImageOf<PixelRgb> > imgPortIn;
     ev::vWritePort eventPortOut;
 
-    cv::Mat ref_values;
-    cv::Mat prev_img;
+    esimCore simulator;
     double prev_time;
 
     Stamp curr_stamp;
 
-    struct
+    //offline mode
+    bool offline;
+    std::string video_file;
+    std::string output_file;
+    double fps;
+    unsigned long int n_frames;
+    unsigned long int n_events;
+
+    void runOffline()
     {
-        double C;
-        double log_eps;
-        double noise_variance;
-        bool use_log_image;
-    } config_;
+        cv::VideoCapture capture(video_file);
+        if(!capture.isOpened()) {
+            yError() << "Could not open" << video_file;
+            return;
+        }
+
+        std::ofstream event_dumper(output_file, std::ios::out | std::ios::binary);
+        if(!event_dumper.is_open()) {
+            yError() << "Could not open" << output_file;
+            return;
+        }
+
+        if(fps <= 0) fps = capture.get(CAP_PROP_FPS);
+        if(fps <= 0) fps = 30.0;
+
+        cv::Mat frame, rgb;
+        vector<AE> events;
+        vector<int32_t> encoded;
+        double tic = yarp::os::Time::now();
+        prev_time = 0.0;
+
+        while(!Thread::isStopping() && capture.read(frame)) {
+
+            //video frames are BGR, the simulator expects yarp RGB
+            cvtColor(frame, rgb, COLOR_BGR2RGB);
+            double curr_time = n_frames / fps;
+            simulator.process(rgb, prev_time, curr_time, events);
+            prev_time = curr_time;
+            n_frames++;
+
+            //write the event-stream in the binaryDumper format
+            encoded.resize(events.size() * 2);
+            unsigned int pos = 0;
+            for(auto &v : events)
+                v.encode(encoded, pos);
+            event_dumper.write((const char *)encoded.data(), pos * sizeof(int32_t));
+            n_events += events.size();
+        }
+
+        double toc = yarp::os::Time::now();
+        yInfo() << "Simulated" << n_frames << "frames," << n_events
+                << "events in" << toc - tic << "s ("
+                << n_events / std::max(toc - tic, 1e-6) << "events/s)";
+    }
 
 public:
 
+    EsimModule() : prev_time(0.0), offline(false), fps(0.0), n_frames(0),
+        n_events(0) {}
+
     bool configure(yarp::os::ResourceFinder &rf)
     {
 
         std::string moduleName = rf.check("name", Value("/esim-yarp"), "module name (string)").asString();
         setName(moduleName.c_str());
 
+        esimConfig config;
+        config.log_eps = rf.check("log_eps", Value(0.001)).asDouble();
+        config.C = rf.check("C", Value(0.15)).asDouble();
+        config.noise_variance = rf.check("noise_variance", Value(0.25)).asDouble();
+        config.use_log_image = rf.check("use_log_image", Value(true)).asBool();
+        config.max_events = rf.check("max_events", Value(100)).asInt();
+        simulator.configure(config, rf.check("threads", Value(0)).asInt());
+
+        //offline: video file -> binary event file without any yarp ports
+        offline = rf.check("video");
+        if(offline) {
+            video_file = rf.find("video").asString();
+            output_file = rf.check("output", Value("esim_events.log")).asString();
+            fps = rf.check("fps", Value(0.0)).asDouble();
+            return Thread::start();
+        }
+
         yarp::os::Network yarp;
         if (!yarp.checkNetwork(2.0))
         {
@@ -94,14 +394,15 @@ public:
             return false;
         }
 
-        config_.log_eps = rf.check("log_eps", Value(0.001)).asDouble();
-        config_.C = rf.check("C", Value(1e-6)).asDouble();
-        config_.noise_variance = rf.check("noise_variance", Value(0.25)).asDouble();
-        config_.use_log_image = rf.check("use_log_image", Value(true)).asBool();
-
         return Thread::start();
     }
 
+    bool interruptModule()
+    {
+        imgPortIn.interrupt();
+        return Thread::stop();
+    }
+
     bool close()
     {
         imgPortIn.close();
@@ -116,71 +417,22 @@ public:
 
     bool updateModule()
     {
+        if(offline) {
+            yInfo() << n_frames << "frames" << n_events << "events";
+            return Thread::isRunning();
+        }
         return true;
     }
 
-    deque<AE> processImage(const cv::Mat &img, double curr_time) {
-
-        static constexpr double pixelscaler = 1.0 / 255.0;
-        static Mat imgC1, img64, noise, diff64, abs64, abs8;
-
-        //perform image pre-processing (grey, double, log)
-        if(img.channels() > 1)
-            cvtColor(img, imgC1, COLOR_RGB2GRAY);
-        else
-            imgC1 = img;
-        imgC1.convertTo(img64, CV_64F, pixelscaler);
-
-        if (config_.use_log_image)
-            cv::log(config_.log_eps + img64, img64);
-
-
-        //if first image we need to initialise based on the image size
-        if (prev_img.empty()) {
-            img64.copyTo(prev_img);
-            ref_values = cv::Mat::zeros(prev_img.size(), CV_64F);
-            noise = Mat::zeros(prev_img.size(), CV_64F);
-            yInfo() << "Initialized event camera simulator with sensor size: " << prev_img.cols << "x" << prev_img.rows ;
-            return {}; //do not produce events on the first image
-        }
-
-        //create the noise matrix
-        double delta_t = curr_time - prev_time;
-        prev_time = curr_time;
-        cv::randn(noise, 0, config_.noise_variance*delta_t);
-
-        //create the image difference and move current image to previous image
-        diff64 = img64 - prev_img;
-        img64.copyTo(prev_img);
-
-        //update the reference values from diff and noise
-        ref_values += (diff64 + noise);
-
-        // For each pixel, check if new events need to be generated since the last image sample
-        abs64 = cv::abs(ref_values);
-        cv::threshold(abs64, abs64, config_.C, 1.0, CV_THRESH_TOZERO);
-        abs64.convertTo(abs8, CV_8U);
-
-        // create events for each pixel that exceeds the threshold
-        cv::Mat event_list;
-        cv::findNonZero(abs8, event_list);
-
-        static ev::AddressEvent v;
-        std::deque<ev::AddressEvent> events;
-        for (size_t i = 0; i < event_list.total(); i++) {
-            v.x = event_list.at<cv::Point>(i).x;
-            v.y = event_list.at<cv::Point>(i).y;
-            v.stamp = curr_time * vtsHelper::vtsscaler; // To comply with ATIS timestamp
-            v.polarity = (ref_values.at<double>(v.y, v.x) > 0.0) ? 0 : 1;
-            events.push_back(v);
+    void run() {
 
-            ref_values.at<double>(v.y, v.x) = 0.0;
+        if(offline) {
+            runOffline();
+            return;
         }
 
-        return events;
-    }
-
-    void run() {
+        vector<AE> events;
+        bool first = true;
 
         while (!Thread::isStopping()) {
 
@@ -192,9 +444,14 @@ public:
             //update timing information based on image when images are available
             //this could use the imgPortIn.getEnvelope() if it is valid
             curr_stamp.update();
+            double curr_time = curr_stamp.getTime();
+            if(first) prev_time = curr_time;
+            first = false;
 
             //produce and write events
-            deque<AE> events = processImage(yarp::cv::toCvMat(*yarpImage), curr_stamp.getTime());
+            simulator.process(yarp::cv::toCvMat(*yarpImage), prev_time,
+                              curr_time, events);
+            prev_time = curr_time;
             if(!events.empty())
                 eventPortOut.write(events, curr_stamp);
         }
@@ -59,6 +59,8 @@ public:
     vCircleMultiSize * cObserverL;
     vCircleMultiSize * cObserverR;
     double inlierThreshold;
+    int topk;
+    double topkSeparation;
     bool hough;
     double timecounter;
 
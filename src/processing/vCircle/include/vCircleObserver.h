@@ -21,6 +21,7 @@
 
 #include <yarp/sig/all.h>
 #include <event-driven/all.h>
+#include <cstdint>
 #include <event-driven/deprecated.h>
 
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -141,6 +142,162 @@ public:
 
 };
 
+/*////////////////////////////////////////////////////////////////////////////*/
+//VHOUGHVOLUME
+/*////////////////////////////////////////////////////////////////////////////*/
+///
+/// \brief The vHoughVolume class performs a circular Hough transform over a
+/// range of radii using a single (x, y, r) accumulator
+///
+/// Radii are split into bands of roughly equal voting cost and each band is
+/// owned by one worker of a fixed pool (sized to the number of cores), so no
+/// two workers ever write the same memory. Each packet is converted once into
+/// a flat list of votes which all workers read.
+///
+/// Maxima are maintained incrementally: each radius plane is divided into
+/// square blocks, blocks touched by a vote have their maximum recomputed, and
+/// a tournament tree over the block maxima gives the peak of each radius in
+/// O(1) and the top-k peaks over all radii in O(k log n).
+///
+class vHoughVolume
+{
+
+private:
+
+    /// a pool worker that updates a contiguous band of radii
+    class bandWorker : public yarp::os::Thread
+    {
+    private:
+
+        vHoughVolume *volume;
+        yarp::os::Semaphore go;
+        yarp::os::Semaphore &done;
+
+    public:
+
+        int r0, r1; /// band of radius indices [r0, r1)
+
+        bandWorker(vHoughVolume *volume, yarp::os::Semaphore &done) :
+            volume(volume), go(0), done(done), r0(0), r1(0) {}
+        void trigger() { go.post(); }
+        void onStop() { go.post(); }
+        void run();
+    };
+
+    //parameters
+    int rLow; /// smallest radius
+    int nR; /// number of radii
+    int height; /// sensor height
+    int width; /// sensor width
+    bool directed; /// use the directed Hough transform
+    double Hstr; /// normalised Hough strength
+
+    //data
+    std::vector<std::uint16_t> H; /// (r, y, x) accumulator
+    std::vector< std::vector<int> > hx; /// per radius x offsets of the arc
+    std::vector< std::vector<int> > hy; /// per radius y offsets of the arc
+    std::vector< std::vector<int> > hoff; /// per radius linear offsets
+    std::vector<int> a; /// per radius length of the directed arc
+    yarp::sig::ImageOf<yarp::sig::PixelBgr> canvas;
+
+    //peak maintenance
+    static const int block_bits = 3; /// blocks of 8x8 pixels
+    int nbx; /// number of blocks along x
+    int nby; /// number of blocks along y
+    int nleaf; /// number of tree leaves (power of 2 >= blocks)
+    std::vector< std::vector<std::uint16_t> > bmax; /// per block maximum
+    std::vector< std::vector<int> > bidx; /// per block maximum location
+    std::vector< std::vector<int> > tree; /// per radius tournament tree
+    std::vector< std::vector<char> > dirty; /// per block touched flag
+    std::vector< std::vector<int> > touched; /// per radius touched blocks
+
+    //current packet of votes
+    std::vector<int> vx;
+    std::vector<int> vy;
+    std::vector<int> vs;
+    std::vector<double> vth; /// direction of the arc centre (0 -> 1)
+
+    //worker pool
+    std::vector<bandWorker *> workers;
+    yarp::os::Semaphore done;
+    int own_r0, own_r1; /// band processed by the calling thread
+
+    std::uint16_t * plane(int ri) { return H.data() + ri * height * width; }
+
+    /// flag the block containing (x, y) for a maximum update
+    void touch(int ri, int x, int y)
+    {
+        int b = (y >> block_bits) * nbx + (x >> block_bits);
+        if(!dirty[ri][b]) {
+            dirty[ri][b] = 1;
+            touched[ri].push_back(b);
+        }
+    }
+    /// the block with the larger maximum (-1 for an empty leaf)
+    int winner(int ri, int b1, int b2)
+    {
+        if(b2 < 0) return b1;
+        if(b1 < 0) return b2;
+        return bmax[ri][b1] >= bmax[ri][b2] ? b1 : b2;
+    }
+    /// recompute the maximum of a block and replay its tournament path
+    void refreshBlock(int ri, int b);
+    /// refresh all blocks touched since the last update
+    void refreshPeaks(int ri);
+
+    /// update a band of radii with all votes of the current packet
+    void vote(int r0, int r1);
+    /// update a single radius using the standard method
+    void voteAddress(int ri);
+    /// update a single radius using the directed method
+    void voteFlow(int ri);
+
+public:
+
+    ///
+    /// \brief vHoughVolume constructor
+    /// \param rLow smallest circle radius
+    /// \param rHigh largest circle radius
+    /// \param directed use directed Hough transform
+    /// \param threads size of the worker pool (0 = number of cores)
+    /// \param height sensor height
+    /// \param width sensor width
+    /// \param arclength arc length of the directed transform (degrees)
+    ///
+    vHoughVolume(int rLow, int rHigh, bool directed, int threads = 0,
+                 int height = 128, int width = 128, double arclength = 15);
+    ~vHoughVolume();
+
+    ///
+    /// \brief process update all radii given adds (1) and subs (-1)
+    /// \param procQueue list of events
+    /// \param procType strength of each event
+    ///
+    void process(const ev::vQueue &procQueue, const std::vector<int> &procType);
+
+    int numRadii() { return nR; }
+    int getR(int ri) { return rLow + ri; }
+    int getX(int ri) { return bidx[ri][tree[ri][1]] % width; }
+    int getY(int ri) { return bidx[ri][tree[ri][1]] / width; }
+    double getScore(int ri) { return bmax[ri][tree[ri][1]] * Hstr; }
+
+    /// \brief get the strongest response over all radii
+    double getObs(int &x, int &y, int &r);
+
+    /// \brief append (x, y, r, score) of every location above threshold
+    int findScores(std::vector<double> &values, double threshold);
+
+    /// \brief append (x, y, r, score) of the k strongest block peaks that
+    /// have a score above threshold, strongest first. A peak closer than
+    /// min_distance (in x, y and r) to a stronger one is suppressed
+    int getTopK(std::vector<double> &values, int k, double threshold,
+                double min_distance = 0);
+
+    /// \brief create an image of the strongest response over all radii
+    yarp::sig::ImageOf<yarp::sig::PixelBgr> makeDebugImage(double refval);
+
+};
+
 /*////////////////////////////////////////////////////////////////////////////*/
 //VCIRCLEMULTISIZE
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -164,8 +321,7 @@ private:
     ev::temporalSurface tFIFO;
     ev::lifetimeSurface lFIFO;
     ev::event<> dummy;
-    std::vector<vCircleThread *> htransforms;
-    std::vector<vCircleThread *>::iterator best;
+    vHoughVolume *volume;
     std::vector<int> procType;
 
     void addHough(ev::event<> event);
@@ -190,6 +346,7 @@ public:
     void addQueue(ev::vQueue &additions);
     double getObs(int &x, int &y, int &r);
     std::vector<double> getPercentile(double p, double thMin);
+    std::vector<double> getTopK(int k, double thMin, double min_distance = 0);
     yarp::sig::ImageOf<yarp::sig::PixelBgr> makeDebugImage();
 
 };
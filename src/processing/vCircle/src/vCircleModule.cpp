@@ -58,6 +58,9 @@ bool vCircleModule::configure(yarp::os::ResourceFinder &rf)
 
     int radmin = rf.check("radmin", yarp::os::Value(10)).asInt();
     int radmax = rf.check("radmax", yarp::os::Value(35)).asInt();
+    int topk = rf.check("topk", yarp::os::Value(1)).asInt();
+    double topkSeparation =
+            rf.check("topkSeparation", yarp::os::Value(radmin)).asDouble();
 
     //filter parameters
 //    double procNoisePos = rf.check("procNoisePos",
@@ -85,6 +88,8 @@ bool vCircleModule::configure(yarp::os::ResourceFinder &rf)
 
     //initialise the dection and tracking
     circleReader.inlierThreshold = inlierThreshold;
+    circleReader.topk = topk;
+    circleReader.topkSeparation = topkSeparation;
     circleReader.setSingleQ(singleq);
 
     //open the ports
@@ -129,6 +134,8 @@ double vCircleModule::getPeriod()
 vCircleReader::vCircleReader()
 {
     inlierThreshold = 5;
+    topk = 1;
+    topkSeparation = 0;
     hough = false;
     timecounter = 0;
     strictness = false;
@@ -285,7 +292,26 @@ void vCircleReader::onRead(ev::vBottle &inBot)
     int bestxL, bestyL, bestrL;
     double bestScoreL = cObserverL->getObs(bestxL, bestyL, bestrL);
 
-    if(bestScoreL > inlierThreshold) {
+    if(topk > 1) {
+
+        //publish all circle candidates of both cameras
+        for(int channel = 0; channel < 2; channel++) {
+            vCircleMultiSize *observer = channel ? cObserverR : cObserverL;
+            std::vector<double> candidates =
+                    observer->getTopK(topk, inlierThreshold, topkSeparation);
+            for(unsigned int i = 0; i < candidates.size(); i += 4) {
+                auto circevent = ev::make_event<ev::GaussianAE>();
+                circevent->stamp = q.back()->stamp;
+                circevent->setChannel(channel);
+                circevent->x = candidates[i];
+                circevent->y = candidates[i+1];
+                circevent->sigx = candidates[i+2];
+                circevent->sigy = 1;
+                outBottle.addEvent(circevent);
+            }
+        }
+
+    } else if(bestScoreL > inlierThreshold) {
 
         //std::cout << bestx << " " << besty << " " << bestr << std::endl;
         auto circevent = ev::make_event<ev::GaussianAE>();
@@ -303,7 +329,7 @@ void vCircleReader::onRead(ev::vBottle &inBot)
     int bestxR, bestyR, bestrR;
     double bestScoreR = cObserverR->getObs(bestxR, bestyR, bestrR);
 
-    if(bestScoreR > inlierThreshold) {
+    if(topk <= 1 && bestScoreR > inlierThreshold) {
 
         //std::cout << bestx << " " << besty << " " << bestr << std::endl;
         auto circevent = ev::make_event<ev::GaussianAE>();
@@ -18,6 +18,10 @@
 
 #include "vCircleObserver.h"
 #include <math.h>
+#include <thread>
+#include <algorithm>
+#include <queue>
+#include <tuple>
 
 using ev::event;
 using ev::as_event;
@@ -256,6 +260,427 @@ yarp::sig::ImageOf<yarp::sig::PixelBgr> vCircleThread::makeDebugImage(double ref
     return canvas;
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+//VHOUGHVOLUME
+/*////////////////////////////////////////////////////////////////////////////*/
+void vHoughVolume::bandWorker::run()
+{
+    while(true) {
+
+        go.wait();
+        if(isStopping())
+            break;
+
+        volume->vote(r0, r1);
+
+        done.post();
+    }
+}
+
+vHoughVolume::vHoughVolume(int rLow, int rHigh, bool directed, int threads,
+                           int height, int width, double arclength) :
+    done(0)
+{
+    this->rLow = rLow;
+    this->nR = std::max(rHigh - rLow + 1, 1);
+    this->directed = directed;
+    this->height = height;
+    this->width = width;
+    Hstr = 0.05;
+
+    H.resize(nR * height * width, 0);
+    hx.resize(nR); hy.resize(nR); hoff.resize(nR);
+    a.resize(nR, 0);
+
+    //the same arc LUT as vCircleThread, computed for each radius
+    double alr  = arclength * M_PI / 180.0;
+    for(int ri = 0; ri < nR; ri++) {
+        int R = rLow + ri;
+        int x = R; int y = 0;
+        for(double th = 0; th <= 2 * M_PI; th+=0.01) {
+
+            int xn = R * cos(th) + 0.5;
+            int yn = R * sin(th) + 0.5;
+
+            if((xn != x || yn != y) && (sqrt(pow(xn, 2.0)+pow(yn, 2.0))-R < 0.4)) {
+                x = xn;
+                y = yn;
+                hy[ri].push_back(y);
+                hx[ri].push_back(x);
+                hoff[ri].push_back(y * width + x);
+            }
+
+            if(!a[ri] && th > alr) a[ri] = hx[ri].size();
+        }
+    }
+
+    canvas.resize(width, height);
+    canvas.zero();
+
+    //block maxima and a tournament tree over them for each radius
+    const int bs = 1 << block_bits;
+    nbx = (width + bs - 1) >> block_bits;
+    nby = (height + bs - 1) >> block_bits;
+    nleaf = 1;
+    while(nleaf < nbx * nby) nleaf <<= 1;
+
+    bmax.resize(nR, std::vector<std::uint16_t>(nbx * nby, 0));
+    bidx.resize(nR, std::vector<int>(nbx * nby, 0));
+    tree.resize(nR, std::vector<int>(2 * nleaf, -1));
+    dirty.resize(nR, std::vector<char>(nbx * nby, 0));
+    touched.resize(nR);
+    for(int ri = 0; ri < nR; ri++) {
+        for(int b = 0; b < nbx * nby; b++) {
+            bidx[ri][b] = ((b / nbx) << block_bits) * width +
+                    ((b % nbx) << block_bits);
+            tree[ri][nleaf + b] = b;
+        }
+        for(int node = nleaf - 1; node > 0; node--)
+            tree[ri][node] = winner(ri, tree[ri][2*node], tree[ri][2*node+1]);
+    }
+
+    //split the radii into bands of equal voting cost (arc length ~ R)
+    if(threads <= 0)
+        threads = std::thread::hardware_concurrency();
+    threads = std::max(1, std::min(threads, nR));
+
+    long int total_cost = 0;
+    for(int ri = 0; ri < nR; ri++)
+        total_cost += hx[ri].size();
+
+    std::vector<int> band_start(1, 0);
+    long int cost = 0;
+    for(int ri = 0; ri < nR; ri++) {
+        cost += hx[ri].size();
+        int b = band_start.size();
+        if(b < threads && cost * threads >= total_cost * b && ri + 1 < nR)
+            band_start.push_back(ri + 1);
+    }
+    band_start.push_back(nR);
+
+    //the calling thread processes the first band itself
+    own_r0 = band_start[0];
+    own_r1 = band_start[1];
+    for(unsigned int b = 1; b + 1 < band_start.size(); b++) {
+        bandWorker *w = new bandWorker(this, done);
+        w->r0 = band_start[b];
+        w->r1 = band_start[b + 1];
+        workers.push_back(w);
+        w->start();
+    }
+
+}
+
+vHoughVolume::~vHoughVolume()
+{
+    for(unsigned int i = 0; i < workers.size(); i++) {
+        workers[i]->stop();
+        delete workers[i];
+    }
+}
+
+void vHoughVolume::process(const ev::vQueue &procQueue,
+                           const std::vector<int> &procType)
+{
+    //convert the packet once into a flat list of votes
+    vx.clear(); vy.clear(); vs.clear(); vth.clear();
+    for(unsigned int i = 0; i < procQueue.size(); i++) {
+
+        if(directed) {
+
+            auto v = as_event<FlowEvent>(procQueue[i]);
+            if(!v) continue;
+
+            //the arc centre does not depend on the radius
+            double velR = sqrt(pow(v->vx, 2.0) + pow(v->vy, 2.0));
+            if(velR == 0) continue;
+            double theta = acos(v->vy / velR) / (2 * M_PI);
+            if(v->vx < 0) theta = 1 - theta;
+            vth.push_back(theta);
+            vx.push_back(v->x);
+            vy.push_back(v->y);
+            vs.push_back(procType[i]);
+
+        } else {
+
+            auto v = as_event<AddressEvent>(procQueue[i]);
+            if(!v) continue;
+
+            vx.push_back(v->x);
+            vy.push_back(v->y);
+            vs.push_back(procType[i]);
+
+        }
+    }
+
+    if(vs.empty())
+        return;
+
+    for(unsigned int i = 0; i < workers.size(); i++)
+        workers[i]->trigger();
+
+    vote(own_r0, own_r1);
+
+    for(unsigned int i = 0; i < workers.size(); i++)
+        done.wait();
+}
+
+void vHoughVolume::vote(int r0, int r1)
+{
+    for(int ri = r0; ri < r1; ri++) {
+        if(directed)
+            voteFlow(ri);
+        else
+            voteAddress(ri);
+        refreshPeaks(ri);
+    }
+}
+
+void vHoughVolume::refreshBlock(int ri, int b)
+{
+    const int bs = 1 << block_bits;
+    int x0 = (b % nbx) << block_bits;
+    int y0 = (b / nbx) << block_bits;
+    int x1 = std::min(x0 + bs, width);
+    int y1 = std::min(y0 + bs, height);
+
+    const std::uint16_t *Hr = plane(ri);
+    int best = y0 * width + x0;
+    for(int y = y0; y < y1; y++) {
+        for(int x = x0; x < x1; x++) {
+            if(Hr[y * width + x] > Hr[best])
+                best = y * width + x;
+        }
+    }
+    bmax[ri][b] = Hr[best];
+    bidx[ri][b] = best;
+
+    std::vector<int> &t = tree[ri];
+    for(int node = (nleaf + b) >> 1; node > 0; node >>= 1)
+        t[node] = winner(ri, t[2*node], t[2*node+1]);
+}
+
+void vHoughVolume::refreshPeaks(int ri)
+{
+    for(unsigned int i = 0; i < touched[ri].size(); i++) {
+        refreshBlock(ri, touched[ri][i]);
+        dirty[ri][touched[ri][i]] = 0;
+    }
+    touched[ri].clear();
+}
+
+void vHoughVolume::voteAddress(int ri)
+{
+    std::uint16_t *Hr = plane(ri);
+    const int R = rLow + ri;
+    const int n = hoff[ri].size();
+    const int *off = hoff[ri].data();
+    const int *ox = hx[ri].data();
+    const int *oy = hy[ri].data();
+
+    for(unsigned int e = 0; e < vs.size(); e++) {
+
+        const int xv = vx[e];
+        const int yv = vy[e];
+        const std::uint16_t s = vs[e];
+
+        if(xv - R >= 0 && xv + R < width && yv - R >= 0 && yv + R < height) {
+
+            //the whole circle is on the sensor: no bounds checks needed
+            std::uint16_t *base = Hr + yv * width + xv;
+            for(int i = 0; i < n; i++)
+                base[off[i]] += s;
+            for(int i = 0; i < n; i++)
+                touch(ri, xv + ox[i], yv + oy[i]);
+
+        } else {
+
+            for(int i = 0; i < n; i++) {
+                int x = xv + ox[i];
+                int y = yv + oy[i];
+                if(y > height - 1 || y < 0 || x > width -1 || x < 0) continue;
+                Hr[y * width + x] += s;
+                touch(ri, x, y);
+            }
+
+        }
+    }
+}
+
+void vHoughVolume::voteFlow(int ri)
+{
+    std::uint16_t *Hr = plane(ri);
+    const int n = hx[ri].size();
+    const int *ox = hx[ri].data();
+    const int *oy = hy[ri].data();
+    const int ar = a[ri];
+
+    for(unsigned int e = 0; e < vs.size(); e++) {
+
+        const int xv = vx[e];
+        const int yv = vy[e];
+        const std::uint16_t s = vs[e];
+        int bir = vth[e] * n;
+
+        //fill in the pixels from the starting pixel for a pixels forward and
+        //backward, on both sides of the event
+        for(int i = bir - ar; i <= bir + ar; i++) {
+
+            int modi =  i;
+            if(i >= n)
+                modi = i - n;
+            if(i < 0)
+                modi = i + n;
+
+            int x = xv + ox[modi];
+            int y = yv + oy[modi];
+            if(y >= 0 && y < height && x >= 0 && x < width) {
+                Hr[y * width + x] += s;
+                touch(ri, x, y);
+            }
+
+            x = xv - ox[modi];
+            y = yv - oy[modi];
+            if(y >= 0 && y < height && x >= 0 && x < width) {
+                Hr[y * width + x] += s;
+                touch(ri, x, y);
+            }
+        }
+    }
+}
+
+double vHoughVolume::getObs(int &x, int &y, int &r)
+{
+    int best = 0;
+    for(int ri = 1; ri < nR; ri++)
+        if(getScore(ri) > getScore(best))
+            best = ri;
+
+    x = getX(best);
+    y = getY(best);
+    r = getR(best);
+    return getScore(best);
+}
+
+int vHoughVolume::findScores(std::vector<double> &values, double threshold)
+{
+    const int bs = 1 << block_bits;
+    int c = 0;
+    std::vector<int> stack;
+    for(int ri = 0; ri < nR; ri++) {
+
+        //only descend into subtrees whose maximum is above threshold
+        std::uint16_t *Hr = plane(ri);
+        stack.push_back(1);
+        while(stack.size()) {
+            int node = stack.back(); stack.pop_back();
+            int b = tree[ri][node];
+            if(b < 0 || bmax[ri][b] <= threshold) continue;
+            if(node < nleaf) {
+                stack.push_back(2*node);
+                stack.push_back(2*node+1);
+                continue;
+            }
+
+            int x0 = (b % nbx) << block_bits;
+            int y0 = (b / nbx) << block_bits;
+            for(int y = y0; y < std::min(y0 + bs, height); y++) {
+                for(int x = x0; x < std::min(x0 + bs, width); x++) {
+                    if(Hr[y * width + x] > threshold) {
+                        values.push_back(x);
+                        values.push_back(y);
+                        values.push_back(getR(ri));
+                        values.push_back(Hr[y * width + x]*Hstr);
+                        c++;
+                    }
+                }
+            }
+        }
+    }
+
+    return c;
+}
+
+int vHoughVolume::getTopK(std::vector<double> &values, int k,
+                          double threshold, double min_distance)
+{
+    const size_t first = values.size();
+    const double d2 = min_distance * min_distance;
+
+    //best-first search over all trees: (score, radius index, node)
+    std::priority_queue< std::tuple<int, int, int> > frontier;
+    for(int ri = 0; ri < nR; ri++)
+        frontier.push(std::make_tuple(bmax[ri][tree[ri][1]], ri, 1));
+
+    int c = 0;
+    while(c < k && frontier.size()) {
+
+        int ri = std::get<1>(frontier.top());
+        int node = std::get<2>(frontier.top());
+        frontier.pop();
+
+        int b = tree[ri][node];
+        if(b < 0 || bmax[ri][b] * Hstr <= threshold) continue;
+
+        if(node < nleaf) {
+            for(int child = 2*node; child <= 2*node+1; child++) {
+                int cb = tree[ri][child];
+                if(cb >= 0)
+                    frontier.push(std::make_tuple(bmax[ri][cb], ri, child));
+            }
+            continue;
+        }
+
+        //peaks come out strongest first: drop one that is closer in (x, y, r)
+        //than min_distance to a peak already taken (the same circle seen
+        //from a neighbouring block or radius)
+        int x = bidx[ri][b] % width;
+        int y = bidx[ri][b] / width;
+        int r = getR(ri);
+        bool suppressed = false;
+        for(size_t i = first; i < values.size() && !suppressed; i += 4) {
+            double dx = x - values[i], dy = y - values[i+1], dr = r - values[i+2];
+            suppressed = dx*dx + dy*dy + dr*dr < d2;
+        }
+        if(suppressed) continue;
+
+        values.push_back(x);
+        values.push_back(y);
+        values.push_back(r);
+        values.push_back(bmax[ri][b] * Hstr);
+        c++;
+    }
+
+    return c;
+}
+
+yarp::sig::ImageOf<yarp::sig::PixelBgr> vHoughVolume::makeDebugImage(double refval)
+{
+    for(int y = 0; y < height; y += 1) {
+        for(int x = 0; x < width; x += 1) {
+
+            //strongest response over all radii at this location
+            double h = 0;
+            for(int ri = 0; ri < nR; ri++)
+                h = std::max(h, plane(ri)[y * width + x] * Hstr);
+
+            if(h >= refval*0.9)
+                canvas(y, width - 1 - x) = yarp::sig::PixelBgr(255, 255, 255);
+            else {
+                int I = 255.0 * h / refval;
+                if(I > 254) I = 254;
+                if(directed)
+                    canvas(y, width - 1 - x) = yarp::sig::PixelBgr(0, I, 0);
+                else
+                    canvas(y, width - 1 - x) = yarp::sig::PixelBgr(0, 0, I);
+            }
+
+        }
+    }
+
+    return canvas;
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 //VCIRCLEMULTISIZE
 /*////////////////////////////////////////////////////////////////////////////*/
@@ -269,10 +694,9 @@ vCircleMultiSize::vCircleMultiSize(double threshold, std::string qType,
     this->fifolength = fifolength;
     this->directed = directed;
 
-    for(int r = rLow; r <= rHigh; r++)
-        htransforms.push_back(new vCircleThread(r, directed, parallel, height, width, arclength));
+    volume = new vHoughVolume(rLow, rHigh, directed, parallel ? 0 : 1,
+                              height, width, arclength);
 
-    best = htransforms.begin();
     fFIFO = ev::fixedSurface(fifolength, width, height);
     tFIFO = ev::temporalSurface(width, height, fifolength * 7812.5);
     //eFIFO.setThickness(1);
@@ -284,16 +708,7 @@ vCircleMultiSize::vCircleMultiSize(double threshold, std::string qType,
 
 vCircleMultiSize::~vCircleMultiSize()
 {
-
-    ev::vQueue dummy1;
-    std::vector<int> dummy2;
-    std::vector<vCircleThread *>::iterator i;
-    for(i = htransforms.begin(); i != htransforms.end(); i++) {
-        (*i)->stop();
-        (*i)->process(dummy1, dummy2);
-        (*i)->waitfordone();
-        delete *i;
-    }
+    delete volume;
 }
 
 void vCircleMultiSize::addQueue(ev::vQueue &additions) {
@@ -313,27 +728,12 @@ void vCircleMultiSize::addQueue(ev::vQueue &additions) {
 
 void vCircleMultiSize::updateHough(ev::vQueue &procQueue, std::vector<int> &procType)
 {
-
-    std::vector<vCircleThread *>::iterator i;
-    for(i = htransforms.begin(); i != htransforms.end(); i++)
-        (*i)->process(procQueue, procType);
-
-    for(i = htransforms.begin(); i != htransforms.end(); i++)
-        (*i)->waitfordone();
-
+    volume->process(procQueue, procType);
 }
 
 double vCircleMultiSize::getObs(int &x, int &y, int &r)
 {
-    std::vector<vCircleThread *>::iterator i;
-    for(i = htransforms.begin(); i != htransforms.end(); i++)
-        if((*i)->getScore() > (*best)->getScore())
-            best = i;
-
-    x = (*best)->getX();
-    y = (*best)->getY();
-    r = (*best)->getR();
-    return (*best)->getScore();
+    return volume->getObs(x, y, r);
 
 }
 
@@ -344,13 +744,19 @@ std::vector<double> vCircleMultiSize::getPercentile(double p, double thMin)
     double threshold = std::max(p * maxval, (double)thMin);
 
     std::vector<double> values;
-    std::vector<vCircleThread *>::iterator i;
-    for(i = htransforms.begin(); i != htransforms.end(); i++)
-        (*i)->findScores(values, threshold);
+    volume->findScores(values, threshold);
 
     return values;
 }
 
+std::vector<double> vCircleMultiSize::getTopK(int k, double thMin,
+                                              double min_distance)
+{
+    std::vector<double> values;
+    volume->getTopK(values, k, thMin, min_distance);
+    return values;
+}
+
 void vCircleMultiSize::addFixed(ev::vQueue &additions)
 {
     ev::vQueue procQueue;
@@ -578,26 +984,8 @@ void vCircleMultiSize::addEdge(ev::vQueue &additions)
 
 yarp::sig::ImageOf<yarp::sig::PixelBgr> vCircleMultiSize::makeDebugImage()
 {
-
-    std::vector<vCircleThread *>::iterator i;
-    //int dum1, dum2, dum3;
-    double v;
-    //v = this->getObs(dum1, dum2, dum3);
-    v = threshold;
-
-    i = htransforms.begin();
     yarp::sig::ImageOf<yarp::sig::PixelBgr> imagebase =
-            (*i)->makeDebugImage(v);
-
-    for(i++; i != htransforms.end(); i++) {
-        yarp::sig::ImageOf<yarp::sig::PixelBgr> image = (*i)->makeDebugImage(v);
-        for(unsigned int y = 0; y < image.height(); y++) {
-            for(unsigned int x = 0; x < image.width(); x++) {
-                if(image(x, y).g > imagebase(x, y).g)
-                    imagebase(x, y) = image(x, y);
-            }
-        }
-    }
+            volume->makeDebugImage(threshold);
 
     ev::vQueue q;
     if(qType == "fixed")
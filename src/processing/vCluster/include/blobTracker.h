@@ -59,7 +59,7 @@ public:
     //update with new event
     bool addActivity(int x, int y, unsigned long int ts,
                      double Tact, double Tevent);
-    bool decayActivity(int dt, double tau, double Tinact, double Tfree);
+    bool decayActivity(double decay, double Tinact, double Tfree);
     void clusterSpiked();
 
     //updating and getting state
@@ -74,6 +74,8 @@ public:
     inline double get_sigxy() {return sig_xy_;}
     inline int get_x(){return cen_x_;}
     inline int get_y(){return cen_y_;}
+    inline double get_cen_x(){return cen_x_;}
+    inline double get_cen_y(){return cen_y_;}
     inline double get_vx(){return vx_;}
     inline double get_vy(){return vy_;}
     inline double get_act(){return activity_;}
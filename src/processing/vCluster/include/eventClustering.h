@@ -28,6 +28,14 @@
 
 #include <ctime>
 #include <string>
+#include <mutex>
+
+void setPoolParameters(TrackerPool &pool, double alpha_shape, double alpha_pos,
+                       double Tact, double Tinact, double Tfree,
+                       double Tevent, double SigX, double SigY,
+                       double SigXY, bool Fixedshape, int Regrate,
+                       double Maxdist, double decay_tau,
+                       double clusterLimit);
 
 /******************************************************************************/
 //EventBottleManager
@@ -59,6 +67,42 @@ class EventBottleManager : public yarp::os::BufferedPort<ev::vBottle>
 
 };
 
+/******************************************************************************/
+//clusterChannel
+/******************************************************************************/
+// reads vector<AE> packets of a single camera and runs its tracker pool in
+// its own thread, writing the cluster events to a (shared) output port
+class clusterChannel : public yarp::os::Thread
+{
+    private:
+
+        ev::vReadPort< std::vector<ev::AE> > inPort;
+        ev::vWritePort *outPort;
+        std::mutex *outMutex;
+        int channel;
+
+        //per-packet latency statistics
+        std::mutex stats_mutex;
+        int packets;
+        double proc_sum, proc_max;
+        double delay_sum, delay_max;
+
+    public:
+
+        TrackerPool tracker_pool;
+
+        clusterChannel();
+
+        bool    open(std::string name, int channel, ev::vWritePort *outPort,
+                     std::mutex *outMutex, std::string shm_source = "");
+        void    onStop();
+        void    run();
+
+        //return the statistics since the last call and reset them
+        std::string statString();
+
+};
+
 /******************************************************************************/
 //EventClustering
 /******************************************************************************/
@@ -71,6 +115,13 @@ class EventClustering:public yarp::os::RFModule
     EventBottleManager      eventBottleManager;
     bool                    closing;
 
+    /* binary port mode with one thread per camera */
+    bool                    binary{false};
+    clusterChannel          channel_left;
+    clusterChannel          channel_right;
+    ev::vWritePort          outPort;
+    std::mutex              outMutex;
+
 public:
 
     bool configure(yarp::os::ResourceFinder &rf); // configure all the module parameters and return true if successful
@@ -32,6 +32,24 @@ protected:
     //we will store trackers in a vector
     std::vector<BlobTracker> trackers_;
 
+    //structure-of-arrays copy of the tracker centres and inverse covariances
+    //used to evaluate the incoming events
+    std::vector<double> soa_x, soa_y;
+    std::vector<double> soa_ia, soa_ib, soa_ic, soa_norm;
+
+    //uniform grid over the centres of the active and inactive trackers. The
+    //cell size is at least max_dist so an event only needs to be compared to
+    //trackers in its own and the 8 neighbouring cells
+    int cell_size, grid_w, grid_h;
+    std::vector< std::vector<int> > grid;
+    std::vector<int> cell_of;
+    std::vector<int> candidates;
+    std::vector<double> cand_d2, cand_q;
+    std::vector<ev::GaussianAE> scratch;
+
+    void initGrid();
+    void refreshTracker(int i);
+
     int nb_ev_regulate_, count_;
     unsigned long int  ts_last_reg_;
     double decay_tau;
@@ -43,7 +61,7 @@ protected:
     double clusterLimit;
 
     int getNewTracker();
-    ev::event<ev::GaussianAE> makeEvent(int i, int ts);
+    ev::GaussianAE makeEvent(int i, int ts);
     ev::vtsHelper unwrap;
 
 
@@ -67,6 +85,8 @@ public:
 
     int update(ev::event<ev::AddressEvent> v,
                std::vector<ev::event<ev::GaussianAE> > &clEvts);
+    int update(const ev::AddressEvent &v,
+               std::vector<ev::GaussianAE> &clEvts);
 
 };
 
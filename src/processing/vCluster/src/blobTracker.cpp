@@ -127,10 +127,10 @@ bool BlobTracker::addActivity(int x, int y, unsigned long int ts,
     return false;
 }
 
-bool BlobTracker::decayActivity(int dt, double tau, double Tinact, double Tfree)
+bool BlobTracker::decayActivity(double decay, double Tinact, double Tfree)
 {
     State prev_state = state_;
-    activity_ *= exp(-dt/tau);
+    activity_ *= decay;
 
     if(activity_ < Tfree){
         state_ = Free;
@@ -18,6 +18,8 @@
  */
 
 #include "eventClustering.h"
+#include <sstream>
+#include <algorithm>
 
 /******************************************************************************/
 //EventClustering
@@ -68,9 +70,48 @@ bool EventClustering::configure(yarp::os::ResourceFinder &rf)
     //is there a limit on the number of clusters?
     double clusterLimit =
             rf.check("clusterLimit", yarp::os::Value(-1)).asDouble();
+    //use binary ports and a thread for each camera
+    binary = rf.check("binary") &&
+            rf.check("binary", yarp::os::Value(true)).asBool();
+    //publish the latency histograms of the binary input ports
+    if(rf.check("stats") && rf.check("stats", yarp::os::Value(true)).asBool())
+        ev::vTrace::setStatsPort("/" + moduleName + "/stats:o");
+    //binary input ports to read through shared memory, as
+    //(/left/AE:i <port> /right/AE:i <port>)
+    yarp::os::Bottle no_shm;
+    yarp::os::Bottle *shm_source = rf.find("shm_source").asList();
+    if(!shm_source) shm_source = &no_shm;
 
+    closing = false;
 
+    if(binary) {
+
+        setPoolParameters(channel_left.tracker_pool, alphaShape, alphaPos,
+                          Tact, Tinact, Tfree, Tevent, SigX, SigY, SigXY,
+                          Fixedshape, Regrate, Maxdist, decay_tau,
+                          clusterLimit);
+        setPoolParameters(channel_right.tracker_pool, alphaShape, alphaPos,
+                          Tact, Tinact, Tfree, Tevent, SigX, SigY, SigXY,
+                          Fixedshape, Regrate, Maxdist, decay_tau,
+                          clusterLimit);
+
+        outPort.setWriteType(ev::GaussianAE::tag);
+        if(!outPort.open("/" + moduleName + "/GAE:o")) {
+            std::cerr << " : Unable to open ports" << std::endl;
+            return false;
+        }
+        if(!channel_left.open("/" + moduleName + "/left", 0,
+                              &outPort, &outMutex,
+                              shm_source->find("/left/AE:i").asString()) ||
+           !channel_right.open("/" + moduleName + "/right", 1,
+                               &outPort, &outMutex,
+                               shm_source->find("/right/AE:i").asString())) {
+            std::cerr << " : Unable to open ports" << std::endl;
+            return false;
+        }
 
+        return true;
+    }
 
     eventBottleManager.setAllParameters(alphaShape, alphaPos, Tact, Tinact,
                                         Tfree, Tevent, SigX, SigY, SigXY,
@@ -84,7 +125,6 @@ bool EventClustering::configure(yarp::os::ResourceFinder &rf)
         return false;
     }
 
-    closing = false;
     return true ;
 
 }
@@ -93,7 +133,12 @@ bool EventClustering::configure(yarp::os::ResourceFinder &rf)
 bool EventClustering::interruptModule()
 {
     rpcPort.interrupt();
-    eventBottleManager.interrupt();
+    if(binary) {
+        channel_left.stop();
+        channel_right.stop();
+    } else {
+        eventBottleManager.interrupt();
+    }
     return true;
 }
 
@@ -102,7 +147,13 @@ bool EventClustering::close()
 {
     closing = true;
     rpcPort.close();
-    eventBottleManager.close();
+    if(binary) {
+        channel_left.stop();
+        channel_right.stop();
+        outPort.close();
+    } else {
+        eventBottleManager.close();
+    }
 
     return true;
 }
@@ -110,6 +161,10 @@ bool EventClustering::close()
 /******************************************************************************/
 bool EventClustering::updateModule()
 {
+    if(binary) {
+        yInfo() << "[LEFT ]" << channel_left.statString();
+        yInfo() << "[RIGHT]" << channel_right.statString();
+    }
     return !closing;
 }
 
@@ -119,6 +174,113 @@ double EventClustering::getPeriod()
     return 0.1;
 }
 
+void setPoolParameters(TrackerPool &pool, double alpha_shape, double alpha_pos,
+                       double Tact, double Tinact, double Tfree,
+                       double Tevent, double SigX, double SigY,
+                       double SigXY, bool Fixedshape, int Regrate,
+                       double Maxdist, double decay_tau,
+                       double clusterLimit)
+{
+    pool.setComparisonParams(Maxdist);
+    pool.setDecayParams(decay_tau, Tact, Tinact, Tfree, Tevent, Regrate);
+    pool.setInitialParams(SigX, SigY, SigXY, alpha_pos, alpha_shape,
+                          Fixedshape);
+    pool.setClusterLimit(clusterLimit);
+}
+
+/******************************************************************************/
+//clusterChannel
+/******************************************************************************/
+clusterChannel::clusterChannel()
+{
+    outPort = nullptr;
+    outMutex = nullptr;
+    channel = 0;
+    packets = 0;
+    proc_sum = proc_max = 0;
+    delay_sum = delay_max = 0;
+}
+
+/******************************************************************************/
+bool clusterChannel::open(std::string name, int channel,
+                          ev::vWritePort *outPort, std::mutex *outMutex,
+                          std::string shm_source)
+{
+    this->channel = channel;
+    this->outPort = outPort;
+    this->outMutex = outMutex;
+
+    if(!inPort.open(name + "/AE:i", shm_source))
+        return false;
+
+    return start();
+}
+
+/******************************************************************************/
+void clusterChannel::onStop()
+{
+    inPort.close();
+}
+
+/******************************************************************************/
+void clusterChannel::run()
+{
+    yarp::os::Stamp ystamp;
+    std::vector<ev::GaussianAE> clEvts;
+
+    while(true) {
+
+        const std::vector<ev::AE> *q = inPort.read(ystamp);
+        if(!q || isStopping()) break;
+
+        double tic = yarp::os::Time::now();
+
+        clEvts.clear();
+        for(auto &v : *q)
+            tracker_pool.update(v, clEvts);
+
+        if(clEvts.size()) {
+            for(auto &c : clEvts)
+                c.setChannel(channel);
+            outMutex->lock();
+            outPort->write(clEvts, ystamp);
+            outMutex->unlock();
+        }
+
+        double toc = yarp::os::Time::now();
+
+        stats_mutex.lock();
+        packets++;
+        proc_sum += toc - tic;
+        proc_max = std::max(proc_max, toc - tic);
+        delay_sum += toc - ystamp.getTime();
+        delay_max = std::max(delay_max, toc - ystamp.getTime());
+        stats_mutex.unlock();
+    }
+}
+
+/******************************************************************************/
+std::string clusterChannel::statString()
+{
+    std::ostringstream oss;
+
+    stats_mutex.lock();
+    if(packets) {
+        oss << packets << " packets. processing (ms) mean: "
+            << 1000.0 * proc_sum / packets << " max: " << 1000.0 * proc_max
+            << ". latency (ms) mean: " << 1000.0 * delay_sum / packets
+            << " max: " << 1000.0 * delay_max;
+    } else {
+        oss << "no packets";
+    }
+    packets = 0;
+    proc_sum = proc_max = 0;
+    delay_sum = delay_max = 0;
+    stats_mutex.unlock();
+
+    return oss.str();
+}
+
 /******************************************************************************/
 //EventBottleManager
 /******************************************************************************/
@@ -134,20 +296,14 @@ void EventBottleManager::setAllParameters(double alpha_shape, double alpha_pos,
                                           double clusterLimit)
 {
     //left
-    tracker_pool_left.setComparisonParams(Maxdist);
-    tracker_pool_left.setDecayParams(decay_tau, Tact, Tinact, Tfree, Tevent,
-                                     Regrate);
-    tracker_pool_left.setInitialParams(SigX, SigY, SigXY, alpha_pos,
-                                       alpha_shape, Fixedshape);
-    tracker_pool_left.setClusterLimit(clusterLimit);
+    setPoolParameters(tracker_pool_left, alpha_shape, alpha_pos, Tact, Tinact,
+                      Tfree, Tevent, SigX, SigY, SigXY, Fixedshape, Regrate,
+                      Maxdist, decay_tau, clusterLimit);
 
     //right
-    tracker_pool_right.setComparisonParams(Maxdist);
-    tracker_pool_right.setDecayParams(decay_tau, Tact, Tinact, Tfree, Tevent,
-                                     Regrate);
-    tracker_pool_right.setInitialParams(SigX, SigY, SigXY, alpha_pos,
-                                       alpha_shape, Fixedshape);
-    tracker_pool_right.setClusterLimit(clusterLimit);
+    setPoolParameters(tracker_pool_right, alpha_shape, alpha_pos, Tact, Tinact,
+                      Tfree, Tevent, SigX, SigY, SigXY, Fixedshape, Regrate,
+                      Maxdist, decay_tau, clusterLimit);
 
 }
 
@@ -18,6 +18,9 @@
  */
 
 #include "trackerPool.h"
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <algorithm>
 
 TrackerPool::TrackerPool()
 {
@@ -39,6 +42,9 @@ TrackerPool::TrackerPool()
     Tevent = 2;
 
     max_dist = 10;
+    clusterLimit = -1;
+
+    initGrid();
 
 }
 
@@ -68,6 +74,60 @@ void TrackerPool::setDecayParams(double decay_tau, double Tact, double Tinact,
 void TrackerPool::setComparisonParams(double max_dist)
 {
     this->max_dist = max_dist;
+    initGrid();
+}
+
+void TrackerPool::initGrid()
+{
+    //pixel addresses are limited by the AE codec to 10 bits (x) and 9 bits (y)
+    cell_size = std::max((int)std::ceil(max_dist), 1);
+    grid_w = 1024 / cell_size + 1;
+    grid_h = 512 / cell_size + 1;
+    grid.assign(grid_w * grid_h, std::vector<int>());
+
+    cell_of.assign(trackers_.size(), -1);
+    for(unsigned int i = 0; i < trackers_.size(); i++)
+        refreshTracker(i);
+}
+
+void TrackerPool::refreshTracker(int i)
+{
+    BlobTracker &t = trackers_[i];
+
+    if((int)soa_x.size() <= i) {
+        soa_x.resize(i + 1); soa_y.resize(i + 1);
+        soa_ia.resize(i + 1); soa_ib.resize(i + 1); soa_ic.resize(i + 1);
+        soa_norm.resize(i + 1);
+        cell_of.resize(i + 1, -1);
+    }
+
+    //the same terms as BlobTracker::compute_p, computed once per update
+    double det = t.get_sigx2() * t.get_sigy2() - t.get_sigxy() * t.get_sigxy();
+    soa_x[i] = t.get_cen_x();
+    soa_y[i] = t.get_cen_y();
+    soa_ia[i] = t.get_sigy2() / det;
+    soa_ib[i] = t.get_sigxy() / det;
+    soa_ic[i] = t.get_sigx2() / det;
+    soa_norm[i] = 1.0 / (2 * M_PI * sqrt(det));
+
+    //move the tracker to the correct cell (or out of the grid if it is free)
+    int cell = -1;
+    if(t.is_on()) {
+        int gx = std::min(std::max((int)soa_x[i] / cell_size, 0), grid_w - 1);
+        int gy = std::min(std::max((int)soa_y[i] / cell_size, 0), grid_h - 1);
+        cell = gy * grid_w + gx;
+    }
+    if(cell == cell_of[i]) return;
+
+    if(cell_of[i] >= 0) {
+        std::vector<int> &bucket = grid[cell_of[i]];
+        auto it = std::find(bucket.begin(), bucket.end(), i);
+        *it = bucket.back();
+        bucket.pop_back();
+    }
+    if(cell >= 0)
+        grid[cell].push_back(i);
+    cell_of[i] = cell;
 }
 
 void TrackerPool::setClusterLimit(int limit)
@@ -77,11 +137,20 @@ void TrackerPool::setClusterLimit(int limit)
 
 int TrackerPool::update(ev::event<ev::AE> v,
                         std::vector<ev::event<ev::GaussianAE> > &clEvts)
+{
+    scratch.clear();
+    int trackId = update(*v, scratch);
+    for(unsigned int i = 0; i < scratch.size(); i++)
+        clEvts.push_back(std::make_shared<ev::GaussianAE>(scratch[i]));
+    return trackId;
+}
+
+int TrackerPool::update(const ev::AE &v, std::vector<ev::GaussianAE> &clEvts)
 {
 
-    unsigned long int ev_t = unwrap(v->stamp);
-    int ev_x = v->x;
-    int ev_y = v->y;
+    unsigned long int ev_t = unwrap(v.stamp);
+    int ev_x = v.x;
+    int ev_y = v.y;
 
     double max_p = 0;
     int trackId = -1;
@@ -89,15 +158,40 @@ int TrackerPool::update(ev::event<ev::AE> v,
     //the first event sets the beginning of the regulation cycle
     if(ts_last_reg_ < 0) ts_last_reg_ = ev_t;
 
-    // We look for the tracker with the biggest p
-    for(unsigned int ii=0; ii<trackers_.size(); ii++){
-        // only among the Active and Inactive clusters
-        if(trackers_[ii].is_on() && trackers_[ii].dist2event(ev_x, ev_y) < max_dist){
-            double p = trackers_[ii].compute_p(ev_x, ev_y);
-            if(p>max_p || trackId ==-1){
-                max_p = p;
-                trackId = ii;
-            }
+    // We look for the tracker with the biggest p, only among the Active and
+    // Inactive clusters in the neighbouring cells
+    candidates.clear();
+    int gx = std::min(ev_x / cell_size, grid_w - 1);
+    int gy = std::min(ev_y / cell_size, grid_h - 1);
+    for(int cy = std::max(gy - 1, 0); cy <= std::min(gy + 1, grid_h - 1); cy++) {
+        for(int cx = std::max(gx - 1, 0); cx <= std::min(gx + 1, grid_w - 1); cx++) {
+            const std::vector<int> &bucket = grid[cy * grid_w + cx];
+            candidates.insert(candidates.end(), bucket.begin(), bucket.end());
+        }
+    }
+
+    // distance and Mahalanobis terms for all candidates in one pass
+    unsigned int nc = candidates.size();
+    cand_d2.resize(nc); cand_q.resize(nc);
+    const int *ci = candidates.data();
+    double *d2 = cand_d2.data();
+    double *mq = cand_q.data();
+    for(unsigned int k = 0; k < nc; k++) {
+        double dx = ev_x - soa_x[ci[k]];
+        double dy = ev_y - soa_y[ci[k]];
+        d2[k] = dx*dx + dy*dy;
+        mq[k] = dx*dx*soa_ia[ci[k]] - 2*dx*dy*soa_ib[ci[k]] +
+                dy*dy*soa_ic[ci[k]];
+    }
+
+    double max_d2 = max_dist * max_dist;
+    for(unsigned int k = 0; k < nc; k++) {
+        if(d2[k] >= max_d2) continue;
+        double p = soa_norm[ci[k]] * exp(-0.5 * mq[k]);
+        //ties go to the lowest index, as when scanning all trackers
+        if(p > max_p || trackId == -1 || (p == max_p && ci[k] < trackId)) {
+            max_p = p;
+            trackId = ci[k];
         }
     }
 
@@ -111,6 +205,7 @@ int TrackerPool::update(ev::event<ev::AE> v,
             trackers_[trackId].initialisePosition(ev_x, ev_y);
             trackers_[trackId].clusterSpiked();
             trackers_[trackId].isNoLongerFree();
+            refreshTracker(trackId);
         }
     }
 
@@ -118,8 +213,9 @@ int TrackerPool::update(ev::event<ev::AE> v,
     else{
         bool spiked = trackers_[trackId].addActivity(ev_x, ev_y, ev_t, Tact,
                                                      Tevent);
+        refreshTracker(trackId);
         if(spiked) {
-            clEvts.push_back(makeEvent(trackId, v->stamp));
+            clEvts.push_back(makeEvent(trackId, v.stamp));
         }
     }
 
@@ -131,12 +227,16 @@ int TrackerPool::update(ev::event<ev::AE> v,
     ts_last_reg_ = ev_t;
     count_ = 0;
 
+    //the decay is the same for all trackers
+    double decay = exp(-dt / decay_tau);
     for(unsigned int i = 0; i < trackers_.size(); i++){
         // We update the activity of each Active tracker
         if(!(trackers_[i].is_on())) continue;
-        bool spiked = trackers_[i].decayActivity(dt, decay_tau,
-                                                 Tinact, Tfree);
-        if(spiked) clEvts.push_back(makeEvent(i, v->stamp));
+        bool spiked = trackers_[i].decayActivity(decay, Tinact, Tfree);
+        if(spiked) {
+            clEvts.push_back(makeEvent(i, v.stamp));
+            refreshTracker(i);
+        }
     }
 
     return trackId;
@@ -169,22 +269,22 @@ int TrackerPool::getNewTracker()
 
 }
 
-ev::event<ev::GaussianAE> TrackerPool::makeEvent(int i, int ts)
+ev::GaussianAE TrackerPool::makeEvent(int i, int ts)
 {
-    auto clep = ev::make_event<ev::GaussianAE>();
+    ev::GaussianAE clep;
 
-    clep->stamp = ts;
+    clep.stamp = ts;
     if(trackers_[i].is_active()) {
-        clep->polarity = 1;
+        clep.polarity = 1;
     } else {
-        clep->polarity = 0;
+        clep.polarity = 0;
     }
-    clep->x = trackers_[i].get_x();
-    clep->y = trackers_[i].get_y();
-    clep->sigx = trackers_[i].get_sigx2() / 5.0;
-    clep->sigy = trackers_[i].get_sigy2() / 5.0;
-    clep->sigxy = trackers_[i].get_sigxy();
-    clep->ID = i;
+    clep.x = trackers_[i].get_x();
+    clep.y = trackers_[i].get_y();
+    clep.sigx = trackers_[i].get_sigx2() / 5.0;
+    clep.sigy = trackers_[i].get_sigy2() / 5.0;
+    clep.sigxy = trackers_[i].get_sigxy();
+    clep.ID = i;
 
     trackers_[i].clusterSpiked();
     return clep;
@@ -60,6 +60,9 @@ private:
     double tout;
 
     filters convolution;
+
+protected:
+
     bool detectcorner(const ev::vQueue subsurf, int x, int y);
 
 public:
@@ -52,6 +52,8 @@ private:
     yarp::sig::Matrix A2;
     yarp::sig::Vector abc;
 
+protected:
+
     //coputation functions
     bool compute(ev::vSurface2 *surf, double &vx, double &vy);
     int computeGrads(yarp::sig::Matrix &A, yarp::sig::Vector &Y,
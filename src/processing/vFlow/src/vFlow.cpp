@@ -23,26 +23,6 @@ using yarp::math::outerProduct;
 
 using namespace ev;
 
-int main(int argc, char * argv[])
-{
-    /* initialize yarp network */
-    yarp::os::Network yarp;
-    if(!yarp.checkNetwork()) {
-        yError("unable to find YARP server!");
-        return 1;
-    }
-
-    /* prepare and configure the resource finder */
-    yarp::os::ResourceFinder rf;
-    rf.setDefaultConfigFile("vFlow.ini");
-    rf.setDefaultContext("eventdriven");
-    rf.configure(argc, argv);
-
-    /* instantiate the module */
-    vFlowModule module;
-    return module.runModule(rf);
-}
-
 /******************************************************************************/
 //vFlowManager
 /******************************************************************************/
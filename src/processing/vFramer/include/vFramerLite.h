@@ -28,9 +28,11 @@
 #include <yarp/sig/all.h>
 #include <event-driven/all.h>
 #include <event-driven/vIPT.h>
+#include <event-driven/vWindow_basic.h>
 #include <event-driven/vDraw.h>
 #include <opencv2/opencv.hpp>
 #include <map>
+#include <mutex>
 
 using namespace ev;
 using namespace yarp::os;
@@ -43,37 +45,179 @@ using std::deque;
 using std::string;
 using std::map;
 
+/**
+ * @brief The incrementalDraw class is a drawer that keeps a persistent
+ * per-pixel plane of the last timestamp of each polarity. The plane is updated
+ * only with newly received packets (accumulate) and the frame is produced by a
+ * single pass over the plane, so the rendering cost does not depend on the
+ * length of the temporal window.
+ */
+class incrementalDraw : public vDraw {
+
+protected:
+
+    //last timestamp of a positive / negative event at each pixel (-1 = none)
+    cv::Mat ts_pos;
+    cv::Mat ts_neg;
+    int latest_stamp;
+
+    //expire pixels older than the display_window and return the age of the
+    //surviving timestamp (or -1)
+    inline int age(int &ts, int vTime)
+    {
+        if(ts < 0) return -1;
+        int dt = vTime - ts;
+        if(dt < 0) dt += ev::vtsHelper::max_stamp;
+        if((unsigned int)dt > display_window) {
+            ts = -1;
+            return -1;
+        }
+        return dt;
+    }
+
+public:
+
+    incrementalDraw() : latest_stamp(-1) {}
+    virtual void initialise();
+
+    ///
+    /// \brief accumulate updates the timestamp planes with a newly received
+    /// packet of events
+    ///
+    void accumulate(const ev::vQueue &packet);
+};
+
+/**
+ * @brief The framePublisher class resizes and writes the rendered frames of a
+ * channel. When started it runs as a separate pipeline stage: only the most
+ * recent frame is published and stale frames are dropped. Frames can also be
+ * compressed (cv::imencode) and written as (format width height blob) bottles
+ * to be decoded by vImageDecoder.
+ */
+class framePublisher : public yarp::os::Thread {
+
+private:
+
+    BufferedPort< FlexImage > image_port;
+    cv::Size render_size;
+    cv::Mat resized;
+    yarp::os::Stamp ts;
+
+    //compressed output
+    BufferedPort< Bottle > compressed_port;
+    string encoding;
+    vector<int> encode_params;
+    vector<uchar> encoded;
+    std::mutex stat_mutex;
+    int n_encoded;
+    double encode_time;
+    double raw_bytes;
+    double encoded_bytes;
+
+    std::mutex m;
+    yarp::os::Semaphore signal;
+    cv::Mat pending;
+    bool fresh;
+
+public:
+
+    framePublisher(cv::Size render_size = cv::Size(-1, -1)) :
+        render_size(render_size), n_encoded(0), encode_time(0.0),
+        raw_bytes(0.0), encoded_bytes(0.0), signal(0), fresh(false) {}
+
+    /// open name/image:o (and name/compressed:o if encoding)
+    bool open(const string &name);
+    void close();
+
+    ///
+    /// \brief setEncoding enables the compressed output
+    /// \param encoding is jpg (or jpeg) or png
+    /// \param quality is the jpeg quality [0 100] or png compression [0 9]
+    /// \return false (and no compressed output) for another encoding
+    ///
+    bool setEncoding(const string &encoding, int quality);
+    bool isEncoding() { return !encoding.empty(); }
+    /// encode latency and bandwidth since the last call
+    string statString();
+
+    /// resize and write the frame from the calling thread
+    void publish(const cv::Mat &frame);
+    /// hand the frame over to the publishing thread
+    void post(const cv::Mat &frame);
+
+    void onStop() { signal.post(); }
+    void run();
+
+};
+
+class channelInstance;
+
+/**
+ * @brief The layerWorker class renders a subset of the drawers of a
+ * channelInstance into their own layer buffers.
+ */
+class layerWorker : public yarp::os::Thread {
+
+private:
+
+    channelInstance *owner;
+    yarp::os::Semaphore go;
+    yarp::os::Semaphore &done;
+
+public:
+
+    vector<int> layers; /// indices of the drawers rendered by this worker
+
+    layerWorker(channelInstance *owner, yarp::os::Semaphore &done) :
+        owner(owner), go(0), done(done) {}
+    void trigger() { go.post(); }
+    void onStop() { go.post(); }
+    void run();
+
+};
+
 class channelInstance : public RateThread {
 
 private:
 
     string channel_name;
-    unsigned int limit_time;
     yarp::os::Stamp ts;
     BufferedPort< ImageOf<PixelBgr> > frame_read_port;
     cv::Mat current_frame;
     map<string, vReadPort<vQueue> > read_ports;
-    map<string, vQueue> event_qs;
+    map<string, string> shm_sources;
+    map<string, vPacketWindow> event_qs;
     vector<vDraw *> drawers;
-    BufferedPort< FlexImage > image_port;
+    map<string, vector<incrementalDraw *> > incremental_drawers;
+    map<string, bool> queue_required;
+    framePublisher publisher;
     vIPT unwarp;
     bool calib_configured;
-    cv::Size render_size;
 
-    bool updateQs();
+    //layered rendering
+    int render_threads;
+    vector<layerWorker *> workers;
+    vector<int> own_layers;
+    yarp::os::Semaphore done;
+    cv::Mat base;
+    vector<cv::Mat> layers;
+    vector<const vQueue *> layer_qs;
 
-    //events are removed in batches corresponding to packets to reduce
-    //the amount of timestamp comparisons required.
-    map<string, unsigned int> total_time;
-    map<string, deque<unsigned int> > bookmark_time;
-    map<string, deque<unsigned int> > bookmark_n_events;
-    map<string, int> prev_vstamp;
+    bool updateQs();
+    void compositeLayer(cv::Mat &canvas, const cv::Mat &layer);
 
     ev::resolution desired_res;
 
 public:
 
-    channelInstance(string channel_name, cv::Size render_size = cv::Size(-1, -1));
+    channelInstance(string channel_name, cv::Size render_size = cv::Size(-1, -1),
+                    int render_threads = 0);
+    bool setEncoding(const string &encoding, int quality);
+    /// \brief read the input port of this event type through the shared
+    /// memory ring of the writer port shm_source (on this host)
+    void setShmSource(const string &event_type, const string &shm_source);
+    bool isEncoding() { return publisher.isEncoding(); }
+    string statString();
     bool addFrameDrawer(unsigned int width, unsigned int height, 
                         const std::string &calibration_file = "");
     bool addDrawer(string drawer_name, unsigned int width,
@@ -84,6 +228,7 @@ public:
     void threadRelease();
 
     string getName();
+    void renderLayer(int i);
 
 };
 
@@ -114,6 +259,35 @@ public:
     virtual double getPeriod();
 };
 
+class addressPlaneDraw : public incrementalDraw {
+
+public:
+
+    static const std::string drawtype;
+    virtual void draw(cv::Mat &image, const ev::vQueue &eSet, int vTime);
+    virtual std::string getDrawType();
+    virtual std::string getEventType();
+
+};
+
+class saePlaneDraw : public incrementalDraw {
+
+protected:
+
+    //colour as a function of quantised event age
+    std::vector<cv::Vec3b> pos_lut;
+    std::vector<cv::Vec3b> neg_lut;
+
+public:
+
+    virtual void initialise();
+    static const std::string drawtype;
+    virtual void draw(cv::Mat &image, const ev::vQueue &eSet, int vTime);
+    virtual std::string getDrawType();
+    virtual std::string getEventType();
+
+};
+
 class overlayStereoDraw : public vDraw {
 
 public:
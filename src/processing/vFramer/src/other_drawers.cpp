@@ -662,3 +662,127 @@ void rasterDrawHN::draw(cv::Mat &image, const ev::vQueue &eSet, int vTime)
         cv::circle(image, cv::Point(x, y), 5, black, cv::FILLED);
     }
 }
+
+// INCREMENTAL DRAW //
+// ================ //
+
+void incrementalDraw::initialise()
+{
+    ts_pos = cv::Mat(Ylimit, Xlimit, CV_32SC1, cv::Scalar(-1));
+    ts_neg = cv::Mat(Ylimit, Xlimit, CV_32SC1, cv::Scalar(-1));
+    latest_stamp = -1;
+}
+
+void incrementalDraw::accumulate(const ev::vQueue &packet)
+{
+    if(packet.empty()) return;
+
+    for(auto qi = packet.begin(); qi != packet.end(); qi++) {
+
+        auto aep = is_event<AddressEvent>(*qi);
+        int y = aep->y;
+        int x = aep->x;
+        if(flip) {
+            y = Ylimit - 1 - y;
+            x = Xlimit - 1 - x;
+        }
+
+        if(aep->polarity)
+            ts_pos.at<int>(y, x) = aep->stamp;
+        else
+            ts_neg.at<int>(y, x) = aep->stamp;
+    }
+
+    latest_stamp = packet.back()->stamp;
+}
+
+// AE-INC DRAW //
+// =========== //
+
+const std::string addressPlaneDraw::drawtype = "AE-INC";
+
+std::string addressPlaneDraw::getDrawType()
+{
+    return addressPlaneDraw::drawtype;
+}
+
+std::string addressPlaneDraw::getEventType()
+{
+    return AddressEvent::tag;
+}
+
+void addressPlaneDraw::draw(cv::Mat &image, const ev::vQueue &eSet, int vTime)
+{
+    if(vTime < 0) vTime = latest_stamp;
+    if(vTime < 0) return;
+    if(image.rows != Ylimit || image.cols != Xlimit) return;
+
+    for(int y = 0; y < Ylimit; y++) {
+        int *pos = ts_pos.ptr<int>(y);
+        int *neg = ts_neg.ptr<int>(y);
+        cv::Vec3b *cpc = image.ptr<cv::Vec3b>(y);
+        for(int x = 0; x < Xlimit; x++) {
+            bool p = age(pos[x], vTime) >= 0;
+            bool n = age(neg[x], vTime) >= 0;
+            if(p && n)
+                cpc[x] = lime;
+            else if(p)
+                cpc[x] = aqua;
+            else if(n)
+                cpc[x] = violet;
+        }
+    }
+}
+
+// SAE-INC DRAW //
+// ============ //
+
+const std::string saePlaneDraw::drawtype = "SAE-INC";
+
+std::string saePlaneDraw::getDrawType()
+{
+    return saePlaneDraw::drawtype;
+}
+
+std::string saePlaneDraw::getEventType()
+{
+    return AddressEvent::tag;
+}
+
+void saePlaneDraw::initialise()
+{
+    incrementalDraw::initialise();
+
+    pos_lut.resize(256);
+    neg_lut.resize(256);
+    for(int i = 0; i < 256; i++) {
+        double decay = i / 255.0;
+        pos_lut[i] = aqua + (white - aqua) * decay;
+        neg_lut[i] = violet + (white - violet) * decay;
+    }
+}
+
+void saePlaneDraw::draw(cv::Mat &image, const ev::vQueue &eSet, int vTime)
+{
+    if(vTime < 0) vTime = latest_stamp;
+    if(vTime < 0) return;
+    if(image.rows != Ylimit || image.cols != Xlimit) return;
+
+    double lut_scaler = 255.0 / std::max(display_window, 1u);
+
+    for(int y = 0; y < Ylimit; y++) {
+        int *pos = ts_pos.ptr<int>(y);
+        int *neg = ts_neg.ptr<int>(y);
+        cv::Vec3b *cpc = image.ptr<cv::Vec3b>(y);
+        for(int x = 0; x < Xlimit; x++) {
+            int dtp = age(pos[x], vTime);
+            int dtn = age(neg[x], vTime);
+            if(cpc[x] != white) continue;
+            //the most recent polarity is shown
+            if(dtp >= 0 && (dtn < 0 || dtp <= dtn))
+                cpc[x] = pos_lut[(int)(dtp * lut_scaler)];
+            else if(dtn >= 0)
+                cpc[x] = neg_lut[(int)(dtn * lut_scaler)];
+        }
+    }
+}
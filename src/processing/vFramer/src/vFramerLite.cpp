@@ -18,6 +18,7 @@
 
 #include "vFramerLite.h"
 #include <sstream>
+#include <cstring>
 #include <yarp/cv/Cv.h>
 #include "event-driven/vDrawSkin.h"
 
@@ -94,19 +95,171 @@ vDraw * createDrawer(std::string tag)
         return new rasterDraw();
     if(tag == rasterDrawHN::drawtype)
         return new rasterDrawHN();
+    if(tag == addressPlaneDraw::drawtype)
+        return new addressPlaneDraw();
+    if(tag == saePlaneDraw::drawtype)
+        return new saePlaneDraw();
     return 0;
 
 }
 
+/*////////////////////////////////////////////////////////////////////////////*/
+//framePublisher
+/*////////////////////////////////////////////////////////////////////////////*/
+bool framePublisher::open(const string &name)
+{
+    if(!image_port.open(name + "/image:o"))
+        return false;
+    if(isEncoding() && !compressed_port.open(name + "/compressed:o"))
+        return false;
+    return true;
+}
+
+void framePublisher::close()
+{
+    image_port.close();
+    compressed_port.close();
+}
+
+bool framePublisher::setEncoding(const string &encoding, int quality)
+{
+    this->encoding.clear();
+    encode_params.clear();
+    if(encoding == "jpg" || encoding == "jpeg") {
+        encode_params.push_back(cv::IMWRITE_JPEG_QUALITY);
+        encode_params.push_back(std::max(0, std::min(quality, 100)));
+    } else if(encoding == "png") {
+        encode_params.push_back(cv::IMWRITE_PNG_COMPRESSION);
+        encode_params.push_back(std::max(0, std::min(quality, 9)));
+    } else {
+        return false;
+    }
+    this->encoding = encoding;
+    return true;
+}
+
+string framePublisher::statString()
+{
+    std::stringstream ss;
+    stat_mutex.lock();
+    ss << "[" << encoding << "] " << n_encoded << " frames";
+    if(n_encoded) {
+        ss << " " << 1000.0 * encode_time / n_encoded << "ms/frame"
+           << " " << encoded_bytes / 1024.0 << "/" << raw_bytes / 1024.0
+           << "kB (" << 100.0 * (1.0 - encoded_bytes / raw_bytes)
+           << "% saved)";
+    }
+    n_encoded = 0; encode_time = 0.0; raw_bytes = 0.0; encoded_bytes = 0.0;
+    stat_mutex.unlock();
+    return ss.str();
+}
+
+void framePublisher::publish(const cv::Mat &frame)
+{
+    //here we want to rescale the image.
+    if(render_size.width > 0) {
+        cv::resize(frame, resized, render_size);
+    } else {
+        resized = frame;
+    }
+    ts.update();
+
+    //the raw image is only sent to explicit connections when compressing
+    if(!isEncoding() || image_port.getOutputCount()) {
+        if (resized.type() == CV_8UC3) {
+            image_port.prepare().copy(yarp::cv::fromCvMat<PixelBgr>(resized));
+        } else if (resized.type() == CV_8UC1) {
+            image_port.prepare().copy(yarp::cv::fromCvMat<PixelMono>(resized));
+        }
+        image_port.setEnvelope(ts);
+        image_port.write();
+    }
+
+    if(!isEncoding())
+        return;
+
+    double tic = yarp::os::Time::now();
+    if(!cv::imencode("." + encoding, resized, encoded, encode_params)) {
+        yError() << "Could not encode frame as" << encoding;
+        return;
+    }
+    double toc = yarp::os::Time::now();
+
+    Bottle &b = compressed_port.prepare();
+    b.clear();
+    b.addString(encoding);
+    b.addInt(resized.cols);
+    b.addInt(resized.rows);
+    b.add(Value(encoded.data(), (int)encoded.size()));
+    compressed_port.setEnvelope(ts);
+    compressed_port.write();
+
+    stat_mutex.lock();
+    n_encoded++;
+    encode_time += toc - tic;
+    raw_bytes += resized.total() * resized.elemSize();
+    encoded_bytes += encoded.size();
+    stat_mutex.unlock();
+}
+
+void framePublisher::post(const cv::Mat &frame)
+{
+    m.lock();
+    bool was_fresh = fresh;
+    pending = frame;
+    fresh = true;
+    m.unlock();
+
+    //a frame not yet published is replaced and only one wake-up is queued
+    if(!was_fresh)
+        signal.post();
+}
+
+void framePublisher::run()
+{
+    cv::Mat frame;
+    while(true) {
+        signal.wait();
+        if(isStopping()) break;
+
+        m.lock();
+        if(!fresh) {
+            m.unlock();
+            continue;
+        }
+        frame = pending;
+        pending.release();
+        fresh = false;
+        m.unlock();
+
+        publish(frame);
+    }
+}
+
+/*////////////////////////////////////////////////////////////////////////////*/
+//layerWorker
+/*////////////////////////////////////////////////////////////////////////////*/
+void layerWorker::run()
+{
+    while(true) {
+        go.wait();
+        if(isStopping()) break;
+        for(auto i : layers)
+            owner->renderLayer(i);
+        done.post();
+    }
+}
+
 /*////////////////////////////////////////////////////////////////////////////*/
 //channelInstance
 /*////////////////////////////////////////////////////////////////////////////*/
-channelInstance::channelInstance(string channel_name, cv::Size render_size) : RateThread(0.1)
+channelInstance::channelInstance(string channel_name, cv::Size render_size,
+                                 int render_threads) :
+    RateThread(0.1), publisher(render_size), done(0)
 {
     this->channel_name = channel_name;
-    this->limit_time = 1.0 * vtsHelper::vtsscaler;
     calib_configured = false;
-    this->render_size = render_size;
+    this->render_threads = render_threads;
 }
 
 string channelInstance::getName()
@@ -114,6 +267,12 @@ string channelInstance::getName()
     return channel_name;
 }
 
+void channelInstance::setShmSource(const string &event_type,
+                                   const string &shm_source)
+{
+    shm_sources[event_type] = shm_source;
+}
+
 bool channelInstance::addFrameDrawer(unsigned int width, unsigned int height, 
     const std::string &calibration_file)
 {
@@ -144,21 +303,68 @@ bool channelInstance::addDrawer(string drawer_name, unsigned int width,
 
     string event_type = new_drawer->getEventType();
 
+    //incremental drawers are fed each packet once, the event window is only
+    //stored if another drawer of this type needs it
+    incrementalDraw * inc_drawer = dynamic_cast<incrementalDraw *>(new_drawer);
+    if(inc_drawer)
+        incremental_drawers[event_type].push_back(inc_drawer);
+    else
+        queue_required[event_type] = true;
+
     //check to see if we need to open a new input port
     if(read_ports.count(event_type))
         return true;
 
     //open the port
-    total_time[event_type] = 0;
-    prev_vstamp[event_type] = 0;
-    limit_time = isoWindow;
-    return read_ports[event_type].open(channel_name + "/" + event_type + ":i");
+    event_qs[event_type].setWindow(isoWindow);
+    return read_ports[event_type].open(channel_name + "/" + event_type + ":i",
+                                       shm_sources[event_type]);
 
 }
 
 bool channelInstance::threadInit()
 {
-    return image_port.open(channel_name + "/image:o");
+    if(!publisher.open(channel_name))
+        return false;
+
+    //encoding runs as a separate stage
+    if(publisher.isEncoding() && !publisher.start())
+        return false;
+
+    if(render_threads <= 0 || drawers.empty())
+        return true;
+
+    //distribute the drawers (layers) over the calling thread and the workers
+    int n_threads = std::min((int)drawers.size(), render_threads);
+    for(int t = 1; t < n_threads; t++)
+        workers.push_back(new layerWorker(this, done));
+    layers.resize(drawers.size());
+    layer_qs.resize(drawers.size());
+    for(int i = 0; i < (int)drawers.size(); i++) {
+        if(i % n_threads)
+            workers[i % n_threads - 1]->layers.push_back(i);
+        else
+            own_layers.push_back(i);
+    }
+
+    for(auto w : workers) {
+        if(!w->start()) return false;
+    }
+
+    //resizing and publishing runs as a separate stage
+    if(!publisher.isRunning())
+        return publisher.start();
+    return true;
+}
+
+bool channelInstance::setEncoding(const string &encoding, int quality)
+{
+    return publisher.setEncoding(encoding, quality);
+}
+
+string channelInstance::statString()
+{
+    return channel_name + " " + publisher.statString();
 }
 
 bool channelInstance::updateQs()
@@ -178,23 +384,10 @@ bool channelInstance::updateQs()
         for(int i = 0; i < qs_available[event_type]; i++) {
             const vQueue *q = port_i->second.read(yarp_stamp);
 
-            int q_dt = (int)q->back()->stamp - prev_vstamp[event_type];
-            if(q_dt < 0) q_dt += vtsHelper::max_stamp;
-
-            prev_vstamp[event_type] = (int)q->back()->stamp;
-            total_time[event_type] += q_dt;
-            bookmark_time[event_type].push_back(q_dt);
-            bookmark_n_events[event_type].push_back(q->size());
-
-            for(unsigned j = 0; j < q->size(); j++)
-                event_qs[event_type].push_back(q->at(j));
-        }
-        while(total_time[event_type] > limit_time) {
-            for(unsigned int i = 0; i < bookmark_n_events[event_type].front(); i++)
-                event_qs[event_type].pop_front();
-            total_time[event_type] -= bookmark_time[event_type].front();
-            bookmark_time[event_type].pop_front();
-            bookmark_n_events[event_type].pop_front();
+            for(auto inc_i : incremental_drawers[event_type])
+                inc_i->accumulate(*q);
+            if(queue_required[event_type])
+                event_qs[event_type].addPacket(*q);
         }
     }
 
@@ -217,6 +410,30 @@ bool channelInstance::updateQs()
 }
 
 
+void channelInstance::renderLayer(int i)
+{
+    base.copyTo(layers[i]);
+    drawers[i]->draw(layers[i], *layer_qs[i], -1);
+}
+
+void channelInstance::compositeLayer(cv::Mat &canvas, const cv::Mat &layer)
+{
+    if(layer.size() != base.size() || layer.type() != base.type())
+        return;
+
+    //any pixel the drawer changed from the base image is opaque
+    size_t es = base.elemSize();
+    for(int y = 0; y < base.rows; y++) {
+        const uchar *b = base.ptr(y);
+        const uchar *l = layer.ptr(y);
+        uchar *c = canvas.ptr(y);
+        for(int x = 0; x < base.cols * (int)es; x += es) {
+            if(memcmp(l + x, b + x, es))
+                memcpy(c + x, l + x, es);
+        }
+    }
+}
+
 void channelInstance::run()
 {
 
@@ -231,27 +448,35 @@ void channelInstance::run()
         drawers.front()->resetImage(canvas);
     }
 
-    vector<vDraw *>::iterator drawer_i;
-    for(drawer_i = drawers.begin(); drawer_i != drawers.end(); drawer_i++) {
-        (*drawer_i)->draw(canvas, event_qs[(*drawer_i)->getEventType()], -1);
+    if(workers.empty() && own_layers.empty()) {
+        vector<vDraw *>::iterator drawer_i;
+        for(drawer_i = drawers.begin(); drawer_i != drawers.end(); drawer_i++) {
+            (*drawer_i)->draw(canvas, event_qs[(*drawer_i)->getEventType()].getWindow(), -1);
+        }
+        if(publisher.isRunning())
+            publisher.post(canvas);
+        else
+            publisher.publish(canvas);
+        return;
     }
 
-    //here we want to rescale the image.
-    static cv::Mat resized;
-    if(render_size.width > 0) {
-        cv::resize(canvas, resized, render_size);
-    } else {
-        resized = canvas;
-    }
+    //each drawer renders its own layer over the base image concurrently, and
+    //the layers are composited in the order the drawers were given
+    canvas.copyTo(base);
+    for(unsigned int i = 0; i < drawers.size(); i++)
+        layer_qs[i] = &event_qs[drawers[i]->getEventType()].getWindow();
 
-    if (canvas.type() == CV_8UC3) {
-        image_port.prepare().copy(yarp::cv::fromCvMat<PixelBgr>(resized));
-    } else if (canvas.type() == CV_8UC1) {
-        image_port.prepare().copy(yarp::cv::fromCvMat<PixelMono>(resized));
-    }
-    ts.update();
-    image_port.setEnvelope(ts);
-    image_port.write();
+    for(auto w : workers)
+        w->trigger();
+    for(auto i : own_layers)
+        renderLayer(i);
+    for(unsigned int i = 0; i < workers.size(); i++)
+        done.wait();
+
+    for(auto &layer : layers)
+        compositeLayer(canvas, layer);
+
+    publisher.post(canvas);
 }
 
 void channelInstance::threadRelease()
@@ -264,8 +489,17 @@ void channelInstance::threadRelease()
 
     frame_read_port.close();
 
+    //stop the render pipeline
+    for(auto w : workers) {
+        w->stop();
+        delete w;
+    }
+    workers.clear();
+    if(publisher.isRunning())
+        publisher.stop();
+
     //close output port
-    image_port.close();
+    publisher.close();
 
     //delete allocated memory
     std::vector<vDraw *>::iterator drawer_i;
@@ -285,6 +519,10 @@ bool vFramerModule::configure(yarp::os::ResourceFinder &rf)
     string moduleName = rf.check("name", Value("/vFramer")).asString();
     setName(moduleName.c_str());
 
+    //publish the latency histograms of the input ports
+    if(rf.check("stats") && rf.check("stats", Value(true)).asBool())
+        vTrace::setStatsPort(getName("/stats:o"));
+
     int height = rf.check("height", Value(240)).asInt();
     int width = rf.check("width", Value(304)).asInt();
 
@@ -308,6 +546,17 @@ bool vFramerModule::configure(yarp::os::ResourceFinder &rf)
         render_size = cv::Size(rf.find("out_width").asInt(), rf.find("out_height").asInt());
     }
 
+    int renderThreads = rf.check("renderThreads", Value(0)).asInt();
+
+    string encoding = rf.check("encoding", Value("")).asString();
+    int quality = rf.check("quality",
+                           Value(encoding == "png" ? 3 : 90)).asInt();
+    if(!encoding.empty() && encoding != "jpg" && encoding != "jpeg" &&
+            encoding != "png") {
+        yError() << "Unsupported encoding" << encoding << "(use jpg or png)";
+        return false;
+    }
+
     //bool useTimeout =
     //        rf.check("timeout") && rf.check("timeout", Value(true)).asBool();
     
@@ -319,6 +568,13 @@ bool vFramerModule::configure(yarp::os::ResourceFinder &rf)
 //        period = 0;
 //    }
 
+    //input ports to read through shared memory, as
+    //(/Left/AE:i /vPreProcess/left:o ...)
+    yarp::os::Bottle no_shm;
+    yarp::os::Bottle * shm_source = rf.find("shm_source").asList();
+    if(!shm_source)
+        shm_source = &no_shm;
+
     //viewer options
     //set up the default channel list
     yarp::os::Bottle tempDisplayList, *bp;
@@ -347,8 +603,22 @@ bool vFramerModule::configure(yarp::os::ResourceFinder &rf)
         string channel_name =
                 moduleName + displayList->get(i*2).asString();
 
-        channelInstance * new_ci = new channelInstance(channel_name, render_size);
+        channelInstance * new_ci = new channelInstance(channel_name, render_size, renderThreads);
         new_ci->setRate(period);
+        if(!encoding.empty())
+            new_ci->setEncoding(encoding, quality);
+
+        string display = displayList->get(i*2).asString();
+        for(size_t k = 0; k + 1 < shm_source->size(); k += 2) {
+            string input = shm_source->get(k).asString();
+            size_t type_start = display.size() + 1;
+            if(input.size() > type_start + 2 &&
+                    input.compare(0, type_start, display + "/") == 0 &&
+                    input.compare(input.size() - 2, 2, ":i") == 0)
+                new_ci->setShmSource(input.substr(type_start,
+                                                  input.size() - type_start - 2),
+                                     shm_source->get(k + 1).asString());
+        }
 
         Bottle * drawtypelist = displayList->get(i*2 + 1).asList();
         for(unsigned int j = 0; j < drawtypelist->size(); j++)
@@ -400,6 +670,11 @@ bool vFramerModule::close()
 
 bool vFramerModule::updateModule()
 {
+    vector<channelInstance *>::iterator pub_i;
+    for(pub_i = publishers.begin(); pub_i != publishers.end(); pub_i++) {
+        if((*pub_i)->isEncoding())
+            yInfo() << (*pub_i)->statString();
+    }
     return !isStopping();
 }
 
@@ -0,0 +1,498 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/all.h>
+#include <yarp/sig/Vector.h>
+#include <event-driven/all.h>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+
+using namespace ev;
+using namespace yarp::os;
+using std::vector;
+
+/// \brief xorshift64* generator: a few ns per number, so that the generator
+/// is not the bottleneck of the stream it produces
+class fastRandom
+{
+private:
+
+    uint64_t state;
+
+public:
+
+    typedef uint32_t result_type;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFF; }
+
+    fastRandom(uint64_t seed = 1) : state(seed ? seed : 1) {}
+
+    result_type operator()()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (state * 0x2545F4914F6CDD1DULL) >> 32;
+    }
+
+    /// \brief uniform in [0, 1)
+    double uniform()
+    {
+        return (*this)() * (1.0 / 4294967296.0);
+    }
+
+    /// \brief uniform in [0, n)
+    unsigned int below(unsigned int n)
+    {
+        return ((uint64_t)(*this)() * n) >> 32;
+    }
+};
+
+class vGenerator : public RFModule, public Thread {
+
+private:
+
+    enum patternType { NOISE, BARS, DOTS, REPLAY };
+
+    vWritePort output_port;
+    yarp::os::BufferedPort< yarp::sig::Vector > rate_port;
+
+    //stream parameters
+    patternType pattern;
+    int width, height;
+    double rate, imu_rate, skin_rate;
+    size_t packet_size;
+    double period;
+    double noise;
+    double speed;
+    int n_objects;
+    bool mono;
+    bool poisson;
+    bool realtime;
+    bool exact;
+
+    //replayed spatial distribution
+    vector<uint32_t> replay_addresses;
+    std::discrete_distribution<size_t> replay_distribution;
+
+    //generator state (stream time in seconds from the start)
+    fastRandom rng;
+    AE v;
+    vector<double> object_x, object_y;
+    double next_vision, next_imu, next_skin;
+    int imu_sensor;
+
+    //statistics, read by updateModule
+    std::mutex stats_mutex;
+    unsigned long events_sent{0}, packets_sent{0};
+    double max_lag{0.0};
+    double report_time{0.0};
+
+    double interval(double r)
+    {
+        if(poisson)
+            return -std::log(1.0 - rng.uniform()) / r;
+        return 1.0 / r;
+    }
+
+    //only the counts of the addresses are kept: the stamps are regenerated
+    bool loadReplay(const std::string &file)
+    {
+        std::ifstream in(file, std::ios::binary);
+        if(!in.is_open())
+            return false;
+
+        std::map<uint32_t, double> counts;
+        vector<int32_t> data(2 * 100000);
+        while(in) {
+            in.read((char *)data.data(), data.size() * sizeof(int32_t));
+            size_t n = in.gcount() / (2 * sizeof(int32_t));
+            for(size_t i = 0; i < n; i++) {
+                int32_t address = data[2 * i + 1];
+                if(IS_SKIN(address) || IS_IMUSAMPLE(address) || IS_AUDIO(address))
+                    continue;
+                counts[(uint32_t)address]++;
+            }
+        }
+        if(counts.empty())
+            return false;
+
+        vector<double> weights;
+        for(auto &c : counts) {
+            replay_addresses.push_back(c.first);
+            weights.push_back(c.second);
+        }
+        replay_distribution = std::discrete_distribution<size_t>(weights.begin(),
+                                                                 weights.end());
+        return true;
+    }
+
+    //the positions of the bars or dots, moved once per packet
+    void moveObjects(double t)
+    {
+        double radius = 0.35 * std::min(width, height);
+        for(int i = 0; i < n_objects; i++) {
+            if(pattern == BARS) {
+                object_x[i] = std::fmod(speed * t + i * (double)width / n_objects,
+                                        (double)width);
+                object_y[i] = 0.0;
+            } else {
+                double a = speed * t / radius + i * 2.0 * M_PI / n_objects;
+                object_x[i] = 0.5 * width + radius * std::cos(a);
+                object_y[i] = 0.5 * height + radius * std::sin(a);
+            }
+        }
+    }
+
+    void addVision(vector<int32_t> &buffer, double t)
+    {
+        v.stamp = (uint64_t)(t * vtsHelper::vtsscaler) & vtsHelper::max_stamp;
+        v._coded_data = 0;
+        v.channel = mono ? 0 : rng() & 1;
+        v.polarity = rng() & 1;
+
+        patternType p = pattern;
+        if(p != NOISE && rng.uniform() < noise)
+            p = NOISE;
+
+        switch(p) {
+        case NOISE: {
+            v.x = rng.below(width);
+            v.y = rng.below(height);
+            break; }
+        case BARS: {
+            //vertical bars 4 pixels wide, ON events on the leading edge and
+            //OFF events on the trailing edge
+            int x = (int)object_x[rng.below(n_objects)] + (v.polarity ? 4 : 0);
+            x += (int)rng.below(3) - 1;
+            v.x = std::max(0, std::min(width - 1, x));
+            v.y = rng.below(height);
+            break; }
+        case DOTS: {
+            //dots 4 pixels wide evenly spaced on a rotating circle
+            int dot = rng.below(n_objects);
+            int x = (int)object_x[dot] + (int)rng.below(5) - 2;
+            int y = (int)object_y[dot] + (int)rng.below(5) - 2;
+            v.x = std::max(0, std::min(width - 1, x));
+            v.y = std::max(0, std::min(height - 1, y));
+            break; }
+        case REPLAY: {
+            v._coded_data = replay_addresses[replay_distribution(rng)];
+            break; }
+        }
+
+        buffer.push_back(v.stamp);
+        buffer.push_back(v._coded_data);
+    }
+
+    void addIMU(vector<int32_t> &buffer, double t)
+    {
+        //a slow oscillation on each of the 10 sensors in turn
+        IMUevent imu;
+        imu._coded_data = 0;
+        imu.sensor = imu_sensor;
+        imu.value = (int)(8000.0 * std::sin(2.0 * M_PI * t + imu_sensor));
+        imu_sensor = (imu_sensor + 1) % 10;
+
+        buffer.push_back((uint64_t)(t * vtsHelper::vtsscaler) & vtsHelper::max_stamp);
+        buffer.push_back(imu._coded_data | 0x02000000);
+    }
+
+    void addSkin(vector<int32_t> &buffer, double t)
+    {
+        SkinEvent skin;
+        skin._skei = 0;
+        skin.skin = 1;
+        skin.taxel = rng.below(1024);
+        skin.body_part = rng.below(8);
+        skin.polarity = rng() & 1;
+
+        buffer.push_back((uint64_t)(t * vtsHelper::vtsscaler) & vtsHelper::max_stamp);
+        buffer.push_back(skin._skei);
+    }
+
+    //the next packet: events in stamp order until the packet is full or spans
+    //the packet period. Returns the stream time of its last event
+    double fillPacket(vector<int32_t> &buffer)
+    {
+        buffer.clear();
+        double t_first = std::min(next_vision, std::min(next_imu, next_skin));
+        double t_last = t_first;
+        if(pattern == BARS || pattern == DOTS)
+            moveObjects(t_first);
+        while(buffer.size() < 2 * packet_size) {
+            double t = std::min(next_vision, std::min(next_imu, next_skin));
+            if(t - t_first > period)
+                break;
+            if(t == next_vision) {
+                addVision(buffer, t);
+                next_vision += interval(rate);
+            } else if(t == next_imu) {
+                addIMU(buffer, t);
+                next_imu += interval(imu_rate);
+            } else {
+                addSkin(buffer, t);
+                next_skin += interval(skin_rate);
+            }
+            t_last = t;
+        }
+        return t_last;
+    }
+
+    //Time::delay alone can wake late by a scheduler tick. With exact timing
+    //the last part of the wait is spent polling the clock
+    void waitUntil(double deadline)
+    {
+        double remaining = deadline - Time::now();
+        if(!exact) {
+            if(remaining > 0) Time::delay(remaining);
+            return;
+        }
+        if(remaining > 0.002)
+            Time::delay(remaining - 0.002);
+        while(Time::now() < deadline) {}
+    }
+
+public:
+
+    vGenerator() {}
+
+    virtual bool configure(yarp::os::ResourceFinder& rf)
+    {
+        //display help
+        if(rf.check("help") || rf.check("h")) {
+            yInfo() << "vGenerator produces a synthetic event-stream at a set"
+                       " rate, in the format of zynqGrabber, for load testing";
+            yInfo() << "--rate <double>: vision events per second";
+            yInfo() << "--packet <int>: maximum events per packet";
+            yInfo() << "--period <double>: maximum time spanned by a packet (s)";
+            yInfo() << "--pattern <string>: noise | bars | dots | replay";
+            yInfo() << "--file <path>: binaryevents.log whose spatial"
+                       " distribution is replayed (pattern replay)";
+            yInfo() << "--noise <double>: fraction of uniform noise events added"
+                       " to the bars, dots and replay patterns";
+            yInfo() << "--objects <int>: number of bars or dots";
+            yInfo() << "--speed <double>: speed of the bars and dots (pixels/s)";
+            yInfo() << "--height <int>, --width <int>: sensor size";
+            yInfo() << "--mono <bool>: only the left camera";
+            yInfo() << "--imu <double>: IMU samples per second added to the stream";
+            yInfo() << "--skin <double>: skin events per second added to the stream";
+            yInfo() << "--poisson <bool>: exponential intervals between events"
+                       " (a Poisson process) instead of constant ones";
+            yInfo() << "--realtime <bool>: send each packet when the time of its"
+                       " last event is reached (false: as fast as possible)";
+            yInfo() << "--exact <bool>: poll the clock at the end of each wait"
+                       " for precise packet timing (uses a full core)";
+            yInfo() << "--shared_memory <bool>: also publish the stream to shared"
+                       " memory for readers on this host";
+            yInfo() << "--compress <bool>: compress output packets";
+            return false;
+        }
+
+        /* initialize yarp network */
+        yarp::os::Network yarp;
+        if(!yarp.checkNetwork(2.0)) {
+            std::cout << "Could not connect to YARP" << std::endl;
+            return false;
+        }
+
+        //set the module name used to name ports
+        setName((rf.check("name", Value("/vGenerator")).asString()).c_str());
+
+        rate = rf.check("rate", Value(1000000.0)).asDouble();
+        packet_size = std::max(1, rf.check("packet", Value(5000)).asInt());
+        period = rf.check("period", Value(0.001)).asDouble();
+        width = rf.check("width", Value(304)).asInt();
+        height = rf.check("height", Value(240)).asInt();
+        noise = rf.check("noise", Value(0.1)).asDouble();
+        n_objects = std::max(1, rf.check("objects", Value(2)).asInt());
+        speed = rf.check("speed", Value(300.0)).asDouble();
+        imu_rate = rf.check("imu", Value(0.0)).asDouble();
+        skin_rate = rf.check("skin", Value(0.0)).asDouble();
+        mono = rf.check("mono") &&
+               rf.check("mono", Value(true)).asBool();
+        poisson = rf.check("poisson") &&
+                  rf.check("poisson", Value(true)).asBool();
+        realtime = !rf.check("realtime") ||
+                   rf.check("realtime", Value(true)).asBool();
+        exact = rf.check("exact") &&
+                rf.check("exact", Value(true)).asBool();
+        bool shared_memory = rf.check("shared_memory") &&
+                             rf.check("shared_memory", Value(true)).asBool();
+        bool compress = rf.check("compress") &&
+                        rf.check("compress", Value(true)).asBool();
+
+        if(rate <= 0.0 || width < 1 || height < 1) {
+            yError() << "The rate and the sensor size must be positive";
+            return false;
+        }
+
+        std::string pattern_name = rf.check("pattern", Value("bars")).asString();
+        if(pattern_name == "noise") {
+            pattern = NOISE;
+        } else if(pattern_name == "bars") {
+            pattern = BARS;
+        } else if(pattern_name == "dots") {
+            pattern = DOTS;
+        } else if(pattern_name == "replay") {
+            pattern = REPLAY;
+            std::string file = rf.check("file", Value("")).asString();
+            if(!loadReplay(file)) {
+                yError() << "Could not read vision events from" << file;
+                return false;
+            }
+            yInfo() << "Replaying the distribution of" << replay_addresses.size()
+                    << "addresses from" << file;
+        } else {
+            yError() << "Unknown pattern" << pattern_name;
+            return false;
+        }
+
+        //open io ports
+        if(!output_port.open(getName("/AE:o"), shared_memory)) {
+            yError() << "Could not open output port";
+            return false;
+        }
+        output_port.setWriteType(AE::tag);
+        output_port.setCompression(compress);
+
+        if(!rate_port.open(getName("/rate:o")))
+            return false;
+
+        yInfo() << "Generating" << pattern_name << "at" << rate << "events/s"
+                << (poisson ? "(Poisson)" : "") << "in packets of up to"
+                << packet_size << "events /" << period << "s";
+        if(imu_rate > 0.0 || skin_rate > 0.0)
+            yInfo() << "With" << imu_rate << "IMU samples/s and" << skin_rate
+                    << "skin events/s";
+        if(!realtime)
+            yInfo() << "Sending packets as fast as possible";
+
+        //start the asynchronous and synchronous threads
+        return Thread::start();
+    }
+
+    virtual double getPeriod()
+    {
+        return 1.0; //period of synchrnous thread
+    }
+
+    bool interruptModule()
+    {
+        //if the module is asked to stop ask the asynchrnous thread to stop
+        return Thread::stop();
+    }
+
+    void onStop()
+    {
+        //when the asynchrnous thread is asked to stop, close ports and do
+        //other clean up
+        output_port.close();
+        rate_port.close();
+    }
+
+    //synchronous thread
+    virtual bool updateModule()
+    {
+        double now = Time::now();
+        unsigned long events, packets;
+        double lag;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            events = events_sent; events_sent = 0;
+            packets = packets_sent; packets_sent = 0;
+            lag = max_lag; max_lag = 0.0;
+        }
+        double dt = now - report_time;
+        report_time = now;
+        if(dt <= 0.0 || !Thread::isRunning())
+            return Thread::isRunning();
+
+        double requested = rate + imu_rate + skin_rate;
+        double achieved = events / dt;
+        yInfo() << "Requested" << requested << "events/s, achieved" << achieved
+                << "(" << 100.0 * achieved / requested << "%) in"
+                << packets / dt << "packets/s. Maximum lag:" << lag * 1000.0
+                << "ms";
+
+        auto &temp = rate_port.prepare();
+        temp.resize(3);
+        temp[0] = 0.000001 * requested;
+        temp[1] = 0.000001 * achieved;
+        temp[2] = lag;
+        rate_port.write();
+
+        return Thread::isRunning();
+    }
+
+    //asynchronous thread run forever
+    void run()
+    {
+        Stamp yarpstamp;
+        vector<int32_t> buffer;
+        buffer.reserve(2 * packet_size);
+
+        imu_sensor = 0;
+        object_x.resize(n_objects);
+        object_y.resize(n_objects);
+        next_vision = 0.0;
+        next_imu = imu_rate > 0.0 ? 0.0 : INFINITY;
+        next_skin = skin_rate > 0.0 ? 0.0 : INFINITY;
+
+        double start = Time::now();
+        report_time = start;
+
+        while(!Thread::isStopping()) {
+
+            double t = fillPacket(buffer);
+
+            //a packet is sent once its last event has happened. A generator
+            //that cannot keep up sends immediately and the lag grows
+            double lag = 0.0;
+            if(realtime) {
+                waitUntil(start + t);
+                lag = Time::now() - (start + t);
+            }
+
+            yarpstamp.update();
+            output_port.write(buffer, yarpstamp);
+
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            events_sent += buffer.size() / 2;
+            packets_sent++;
+            max_lag = std::max(max_lag, lag);
+        }
+    }
+};
+
+int main(int argc, char * argv[])
+{
+    /* prepare and configure the resource finder */
+    yarp::os::ResourceFinder rf;
+    rf.setVerbose( false );
+    rf.setDefaultContext( "event-driven" );
+    rf.setDefaultConfigFile( "vGenerator.ini" );
+    rf.configure( argc, argv );
+
+    /* create the module */
+    vGenerator instance;
+    return instance.runModule(rf);
+}
@@ -35,6 +35,10 @@ public:
                        " are shown.";
             yInfo() << "x = don't care | 1 = bit must be set | 0 bit must be clear";
             yInfo() << "example --mask 10x011xx";
+            yInfo() << "--shm_source <port>: read this port of a module on"
+                       " this host through its shared memory";
+            yInfo() << "--stats <bool>: publish input latency histograms on"
+                       " /stats:o";
             return false;
         }
 
@@ -48,13 +52,18 @@ public:
         //set the module name used to name ports
         setName((rf.check("name", Value("/vHexviewer")).asString()).c_str());
 
+        //publish the latency histograms of the input ports
+        if(rf.check("stats") && rf.check("stats", Value(true)).asBool())
+            vTrace::setStatsPort(getName("/stats:o"));
+
         //open io ports
-        if(!input_port.open(getName("/AE:i"))) {
+        std::string shm_source = rf.check("shm_source", Value("")).asString();
+        if(!input_port.open(getName("/AE:i"), shm_source)) {
             yError() << "Could not open input port";
             return false;
         }
 
-        if(yarp::os::Network::connect("/zynqGrabber/AE:o", getName("/AE:i"), "fast_tcp")) {
+        if(shm_source.empty() && yarp::os::Network::connect("/zynqGrabber/AE:o", getName("/AE:i"), "fast_tcp")) {
             yWarning() << "Automatically connected to /zynqGrabber/AE:o but"
                           " maybe that's not what you want!";
         }
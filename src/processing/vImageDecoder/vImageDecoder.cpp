@@ -0,0 +1,174 @@
+/*
+ *   Copyright (C) 2017 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <yarp/os/all.h>
+#include <yarp/sig/all.h>
+#include <yarp/cv/Cv.h>
+#include <opencv2/opencv.hpp>
+#include <mutex>
+
+using namespace yarp::os;
+using yarp::sig::FlexImage;
+using yarp::sig::PixelBgr;
+using yarp::sig::PixelMono;
+
+class imageDecoder : public RFModule, public Thread {
+
+private:
+
+    BufferedPort<Bottle> input_port;
+    BufferedPort<FlexImage> output_port;
+
+    std::mutex stat_mutex;
+    int n_decoded;
+    double decode_time;
+    double encoded_bytes;
+
+public:
+
+    imageDecoder() : n_decoded(0), decode_time(0.0), encoded_bytes(0.0) {}
+
+    virtual bool configure(yarp::os::ResourceFinder& rf)
+    {
+        if(rf.check("help") || rf.check("h")) {
+            yInfo() << "vImageDecoder decodes the compressed:o output of"
+                       " vFramer into an image that can be viewed with"
+                       " yarpview";
+            return false;
+        }
+
+        //set the module name used to name ports
+        setName((rf.check("name", Value("/vImageDecoder")).asString()).c_str());
+
+        //open io ports
+        if(!input_port.open(getName("/compressed:i"))) {
+            yError() << "Could not open input port";
+            return false;
+        }
+
+        if(!output_port.open(getName("/image:o"))) {
+            yError() << "Could not open output port";
+            return false;
+        }
+
+        //start the asynchronous and synchronous threads
+        return Thread::start();
+    }
+
+    virtual double getPeriod()
+    {
+        return 1.0; //period of synchrnous thread
+    }
+
+    bool interruptModule()
+    {
+        //if the module is asked to stop ask the asynchrnous thread to stop
+        return Thread::stop();
+    }
+
+    void onStop()
+    {
+        input_port.close();
+        output_port.close();
+    }
+
+    //synchronous thread
+    virtual bool updateModule()
+    {
+        stat_mutex.lock();
+        if(n_decoded) {
+            yInfo() << n_decoded << "frames"
+                    << 1000.0 * decode_time / n_decoded << "ms/frame"
+                    << encoded_bytes / 1024.0 << "kB received";
+        }
+        n_decoded = 0; decode_time = 0.0; encoded_bytes = 0.0;
+        stat_mutex.unlock();
+
+        return Thread::isRunning();
+    }
+
+    //asynchronous thread run forever
+    void run()
+    {
+        Stamp yarpstamp;
+        cv::Mat decoded;
+
+        while(!Thread::isStopping()) {
+
+            //(encoding width height blob)
+            Bottle *b = input_port.read();
+            if(!b) return;
+            input_port.getEnvelope(yarpstamp);
+
+            if(b->size() < 4 || !b->get(3).isBlob()) {
+                yWarning() << "Unexpected compressed frame format";
+                continue;
+            }
+
+            const Value &blob = b->get(3);
+            cv::Mat buffer(1, (int)blob.asBlobLength(), CV_8UC1,
+                           (void *)blob.asBlob());
+
+            double tic = Time::now();
+            cv::imdecode(buffer, cv::IMREAD_UNCHANGED, &decoded);
+            double toc = Time::now();
+
+            if(decoded.empty()) {
+                yWarning() << "Could not decode" << b->get(0).asString()
+                           << "frame";
+                continue;
+            }
+
+            if(decoded.type() == CV_8UC3) {
+                output_port.prepare().copy(yarp::cv::fromCvMat<PixelBgr>(decoded));
+            } else if(decoded.type() == CV_8UC1) {
+                output_port.prepare().copy(yarp::cv::fromCvMat<PixelMono>(decoded));
+            } else {
+                continue;
+            }
+            output_port.setEnvelope(yarpstamp);
+            output_port.write();
+
+            stat_mutex.lock();
+            n_decoded++;
+            decode_time += toc - tic;
+            encoded_bytes += blob.asBlobLength();
+            stat_mutex.unlock();
+        }
+    }
+};
+
+int main(int argc, char * argv[])
+{
+    yarp::os::Network yarp;
+    if(!yarp.checkNetwork(2.0)) {
+        yError() << "Could not find yarp network";
+        return 1;
+    }
+
+    /* prepare and configure the resource finder */
+    yarp::os::ResourceFinder rf;
+    rf.setVerbose( false );
+    rf.setDefaultContext( "event-driven" );
+    rf.setDefaultConfigFile( "vImageDecoder.ini" );
+    rf.configure( argc, argv );
+
+    /* create the module */
+    imageDecoder instance;
+    return instance.runModule(rf);
+}
@@ -28,6 +28,7 @@
 #include <yarp/sig/all.h>
 #include <event-driven/all.h>
 #include <event-driven/vIPT.h>
+#include <event-driven/vFanOut.h>
 #include <opencv2/opencv.hpp>
 
 class vPreProcess : public yarp::os::RFModule, public yarp::os::Thread
@@ -58,6 +59,14 @@ private:
     ev::vWritePort out_port_crn_stereo;
     yarp::os::BufferedPort< yarp::sig::Vector > rate_port;
 
+    //vision events are encoded once and selected by each output they go to
+    enum { TD, POS, NEG, APS, CRN, N_STREAMS };
+    ev::vFanOut<ev::AE> fanout;
+    int fo_left[N_STREAMS];
+    int fo_right[N_STREAMS];
+    int fo_stereo[N_STREAMS];
+    void route(const int *fo, const ev::AE &v, unsigned int i);
+
     //parameters
     std::string name;
     ev::resolution res;
@@ -85,6 +94,8 @@ private:
     bool combined_stereo;
     bool use_local_stamp;
     bool corners;
+    bool shared_memory;
+    bool compress;
 
     //timing stats
     std::deque<double> delays;
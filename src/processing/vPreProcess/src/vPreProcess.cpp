@@ -108,6 +108,10 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf) {
         yInfo() << "--sf_size <int>: spatial filter (half) size (pixels)";
         yInfo() << "--tf_time <double>: temporal filter time window (sec)";
         yInfo() << "--camera_calibration_file <path>: calibration file to use for undistort";
+        yInfo() << "--shared_memory <bool>: also publish outputs to shared memory"
+                   " for readers on this host";
+        yInfo() << "--compress <bool>: compress output packets (for slow links)";
+        yInfo() << "--stats <bool>: publish input latency histograms on /stats:o";
         return false;
     }
 
@@ -138,6 +142,12 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf) {
               rf.check("corners", Value(true)).asBool();
     vis = rf.check("vis") &&
           rf.check("vis", Value(true)).asBool();
+    shared_memory = rf.check("shared_memory") &&
+                    rf.check("shared_memory", Value(true)).asBool();
+    compress = rf.check("compress") &&
+               rf.check("compress", Value(true)).asBool();
+    if(rf.check("stats") && rf.check("stats", Value(true)).asBool())
+        vTrace::setStatsPort(getName("/stats:o"));
 
     if(!split_stereo) combined_stereo = true;
 
@@ -209,66 +219,106 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf) {
 
 }
 
+void vPreProcess::route(const int *fo, const AE &v, unsigned int i)
+{
+    if(v.type)
+        fanout.select(fo[APS], i);
+    else if(split_polarities)
+        fanout.select(fo[v.polarity ? POS : NEG], i);
+    else
+        fanout.select(fo[TD], i);
+    if(corners && v.corner)
+        fanout.select(fo[CRN], i);
+}
+
 bool vPreProcess::threadInit() {
+    std::fill(fo_left, fo_left + N_STREAMS, -1);
+    std::fill(fo_right, fo_right + N_STREAMS, -1);
+    std::fill(fo_stereo, fo_stereo + N_STREAMS, -1);
+
     if(split_stereo) {
         if(split_polarities) {
-            if(!outPortCamLeft_pos.open(getName() + "/left_pos:o"))
+            if(!outPortCamLeft_pos.open(getName() + "/left_pos:o", shared_memory))
                 return false;
-            if(!outPortCamRight_pos.open(getName() + "/right_pos:o"))
+            fo_left[POS] = fanout.addOutput(outPortCamLeft_pos);
+            if(!outPortCamRight_pos.open(getName() + "/right_pos:o", shared_memory))
                 return false;
-            if(!outPortCamLeft_neg.open(getName() + "/left_neg:o"))
+            fo_right[POS] = fanout.addOutput(outPortCamRight_pos);
+            if(!outPortCamLeft_neg.open(getName() + "/left_neg:o", shared_memory))
                 return false;
-            if(!outPortCamRight_neg.open(getName() + "/right_neg:o"))
+            fo_left[NEG] = fanout.addOutput(outPortCamLeft_neg);
+            if(!outPortCamRight_neg.open(getName() + "/right_neg:o", shared_memory))
                 return false;
+            fo_right[NEG] = fanout.addOutput(outPortCamRight_neg);
         } else {
-            if(!outPortCamLeft.open(getName() + "/left:o"))
+            if(!outPortCamLeft.open(getName() + "/left:o", shared_memory))
                 return false;
-            if(!outPortCamRight.open(getName() + "/right:o"))
+            fo_left[TD] = fanout.addOutput(outPortCamLeft);
+            if(!outPortCamRight.open(getName() + "/right:o", shared_memory))
                 return false;
+            fo_right[TD] = fanout.addOutput(outPortCamRight);
         }
-        if(!out_port_aps_left.open(getName() + "/aps_left:o"))
+        if(!out_port_aps_left.open(getName() + "/aps_left:o", shared_memory))
             return false;
-        if(!out_port_aps_right.open(getName() + "/aps_right:o"))
+        fo_left[APS] = fanout.addOutput(out_port_aps_left);
+        if(!out_port_aps_right.open(getName() + "/aps_right:o", shared_memory))
             return false;
+        fo_right[APS] = fanout.addOutput(out_port_aps_right);
         if(corners) {
-            if(!out_port_crn_left.open(getName() + "/corners/left/AE:o"))
+            if(!out_port_crn_left.open(getName() + "/corners/left/AE:o", shared_memory))
                 return false;
-            if(!out_port_crn_right.open(getName() + "/corners/right/AE:o"))
+            fo_left[CRN] = fanout.addOutput(out_port_crn_left);
+            if(!out_port_crn_right.open(getName() + "/corners/right/AE:o", shared_memory))
                 return false;
+            fo_right[CRN] = fanout.addOutput(out_port_crn_right);
         }
     }
     if(combined_stereo) {
         if(split_polarities) {
-            if(!outPortCamStereo_pos.open(getName() + "/AE_pos:o"))
+            if(!outPortCamStereo_pos.open(getName() + "/AE_pos:o", shared_memory))
                 return false;
-            if(!outPortCamStereo_neg.open(getName() + "/AE_neg:o"))
+            fo_stereo[POS] = fanout.addOutput(outPortCamStereo_pos);
+            if(!outPortCamStereo_neg.open(getName() + "/AE_neg:o", shared_memory))
                 return false;
+            fo_stereo[NEG] = fanout.addOutput(outPortCamStereo_neg);
         } else {
-            if(!outPortCamStereo.open(getName() + "/AE:o"))
+            if(!outPortCamStereo.open(getName() + "/AE:o", shared_memory))
                 return false;
+            fo_stereo[TD] = fanout.addOutput(outPortCamStereo);
         }
         if(corners) {
-            if(!out_port_crn_stereo.open(getName() + "/corners/AE:o"))
+            if(!out_port_crn_stereo.open(getName() + "/corners/AE:o", shared_memory))
                 return false;
+            fo_stereo[CRN] = fanout.addOutput(out_port_crn_stereo);
         }
-        if(!out_port_aps_stereo.open(getName() + "/APS:o"))
+        if(!out_port_aps_stereo.open(getName() + "/APS:o", shared_memory))
             return false;
+        fo_stereo[APS] = fanout.addOutput(out_port_aps_stereo);
 
     }
 
-    if(!out_port_imu_samples.open(getName() + "/imu_samples:o"))
+    if(!out_port_imu_samples.open(getName() + "/imu_samples:o", shared_memory))
         return false;
-    if(!out_port_audio.open(getName() + "/audio:o"))
+    if(!out_port_audio.open(getName() + "/audio:o", shared_memory))
         return false;
-    if(!outPortSkin.open(getName() + "/skin:o"))
+    if(!outPortSkin.open(getName() + "/skin:o", shared_memory))
         return false;
-    if(!outPortSkinSamples.open(getName() + "/skin_samples:o"))
+    if(!outPortSkinSamples.open(getName() + "/skin_samples:o", shared_memory))
         return false;
     if(!inPort.open(getName() + "/AE:i"))
         return false;
     if(!rate_port.open(getName("/rate:o")))
         return false;
 
+    for(auto port : {&outPortCamLeft, &outPortCamLeft_pos, &outPortCamLeft_neg,
+                     &outPortCamRight, &outPortCamRight_pos, &outPortCamRight_neg,
+                     &outPortCamStereo, &outPortCamStereo_pos, &outPortCamStereo_neg,
+                     &outPortSkin, &outPortSkinSamples, &out_port_aps_left,
+                     &out_port_aps_right, &out_port_aps_stereo,
+                     &out_port_imu_samples, &out_port_audio, &out_port_crn_left,
+                     &out_port_crn_right, &out_port_crn_stereo})
+        port->setCompression(compress);
+
     return true;
 }
 
@@ -372,15 +422,11 @@ void vPreProcess::run() {
 
         double pyt = zynq_stamp.getTime();
 
-        std::deque<AE> qleft_pos, qright_pos, qstereo_pos;
-        std::deque<AE> qleft_neg, qright_neg, qstereo_neg;
-        std::deque<AE> qleft, qright, qstereo;
         std::deque<int32_t> qskin;
         std::deque<int32_t> qskinsamples;
-        std::deque<AE> qleft_aps, qright_aps, qstereo_aps;
         std::deque<int32_t> qimusamples;
         std::deque<int32_t> qaudio;
-        std::deque<AE> qleft_corners, qright_corners, qstereo_corners;
+        fanout.clear();
 
         const std::vector<int32_t> *q = inPort.read(zynq_stamp);
         if(!q) break;
@@ -459,52 +505,11 @@ void vPreProcess::run() {
                     v.x = x;
                     v.y = y;
                 }
-                if(split_stereo) {
-                    if(v.channel) {
-                        if(v.type)
-                            qright_aps.push_back(v);
-                        else if(split_polarities) {
-                            if(v.polarity) {
-                                qright_pos.push_back(v);
-                            } else {
-                                qright_neg.push_back(v);
-                            }
-                        } else {
-                            qright.push_back(v);
-                        }
-                        if(corners && v.corner)
-                            qright_corners.push_back(v);
-                    } else {
-                        if(v.type)
-                            qleft_aps.push_back(v);
-                        else if(split_polarities) {
-                            if(v.polarity) {
-                                qleft_pos.push_back(v);
-                            } else {
-                                qleft_neg.push_back(v);
-                            }
-                        } else {
-                            qleft.push_back(v);
-                        }
-                        if(corners && v.corner)
-                            qleft_corners.push_back(v);
-                    }
-                }
-                if(combined_stereo) {
-                    if(v.type)
-                        qstereo_aps.push_back(v);
-                    else if(split_polarities) {
-                        if(v.polarity) {
-                            qstereo_pos.push_back(v);
-                        } else {
-                            qstereo_neg.push_back(v);
-                        }
-                    } else {
-                        qstereo.push_back(v);
-                    }
-                    if(corners && v.corner)
-                        qstereo_corners.push_back(v);
-                }
+                unsigned int i = fanout.add(v);
+                if(split_stereo)
+                    route(v.channel ? fo_right : fo_left, v, i);
+                if(combined_stereo)
+                    route(fo_stereo, v, i);
             }
         }
 
@@ -534,7 +539,7 @@ void vPreProcess::run() {
             }
         }
 
-        v_total += qleft.size() + qright.size();
+        v_total += fanout.count(fo_left[TD]) + fanout.count(fo_right[TD]);
 
         proc_times.push_back((v_total + v_dropped) / (Time::now() - proc_start));
 
@@ -542,63 +547,19 @@ void vPreProcess::run() {
             local_stamp.update();
             zynq_stamp = local_stamp;
         }
-        if(qleft.size()) {
-            outPortCamLeft.write(qleft, zynq_stamp);
-        }
-        if(qright.size()) {
-            outPortCamRight.write(qright, zynq_stamp);
-        }
-        if(qleft_pos.size()) {
-            outPortCamLeft_pos.write(qleft_pos, zynq_stamp);
-        }
-        if(qleft_neg.size()) {
-            outPortCamLeft_neg.write(qleft_neg, zynq_stamp);
-        }
-        if(qright_pos.size()) {
-            outPortCamRight_pos.write(qright_pos, zynq_stamp);
-        }
-        if(qright_neg.size()) {
-            outPortCamRight_neg.write(qright_neg, zynq_stamp);
-        }
-        if(qstereo.size()) {
-            outPortCamStereo.write(qstereo, zynq_stamp);
-        }
-        if(qstereo_pos.size()) {
-            outPortCamStereo_pos.write(qstereo_pos, zynq_stamp);
-        }
-        if(qstereo_neg.size()) {
-            outPortCamStereo_neg.write(qstereo_neg, zynq_stamp);
-        }
+        fanout.writeAll(zynq_stamp);
         if(qskin.size()) {
             outPortSkin.write(qskin, zynq_stamp);
         }
         if(qskinsamples.size()) {
             outPortSkinSamples.write(qskinsamples, zynq_stamp);
         }
-        if(qleft_aps.size()) {
-            out_port_aps_left.write(qleft_aps, zynq_stamp);
-        }
-        if(qright_aps.size()) {
-            out_port_aps_right.write(qright_aps, zynq_stamp);
-        }
-        if(qstereo_aps.size()) {
-            out_port_aps_stereo.write(qstereo_aps, zynq_stamp);
-        }
         if(qimusamples.size()) {
             out_port_imu_samples.write(qimusamples, zynq_stamp);
         }
         if(qaudio.size()) {
             out_port_audio.write(qaudio, zynq_stamp);
         }
-        if(qleft_corners.size()) {
-            out_port_crn_left.write(qleft_corners, zynq_stamp);
-        }
-        if(qright_corners.size()) {
-            out_port_crn_right.write(qright_corners, zynq_stamp);
-        }
-        if(qstereo_corners.size()) {
-            out_port_crn_stereo.write(qstereo_corners, zynq_stamp);
-        }
     }
 }
 
@@ -46,13 +46,23 @@ bool module::configure(yarp::os::ResourceFinder &rf)
 {
     //administrative options
     setName((rf.check("name", yarp::os::Value("/skinInterface")).asString()).c_str());
+    if(rf.check("stats") && rf.check("stats", yarp::os::Value(true)).asBool())
+        ev::vTrace::setStatsPort(getName("/stats:o"));
 
-    if(!skinevents_in.open(getName() + "/SKE:i")) {
+    //input ports to read through shared memory, as
+    //(/SKE:i /vPreProcess/skin:o /SKS:i /vPreProcess/skin_samples:o)
+    yarp::os::Bottle no_shm;
+    yarp::os::Bottle *shm_source = rf.find("shm_source").asList();
+    if(!shm_source) shm_source = &no_shm;
+
+    if(!skinevents_in.open(getName() + "/SKE:i",
+                           shm_source->find("/SKE:i").asString())) {
         yError() << "Could not open events port";
         return false;
     }
 
-    if(!skinsamples_in.open(getName() + "/SKS:i")) {
+    if(!skinsamples_in.open(getName() + "/SKS:i",
+                            shm_source->find("/SKS:i").asString())) {
         yError() << "Could not open samples port";
         return false;
     }